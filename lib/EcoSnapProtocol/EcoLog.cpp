@@ -0,0 +1,196 @@
+#include "EcoLog.h"
+
+#if ECO_LOG_BACKEND == ECO_LOG_RING
+#include <stdio.h>
+#if __has_include(<esp_app_desc.h>)
+#include <esp_app_desc.h>
+#define ECO_LOG_APP_DESC() esp_app_get_description()
+#elif __has_include(<esp_ota_ops.h>)
+#include <esp_ota_ops.h>
+#define ECO_LOG_APP_DESC() esp_ota_get_app_description()
+#endif
+#ifndef RTC_NOINIT_ATTR
+#define RTC_NOINIT_ATTR
+#endif
+
+static_assert((ECO_LOG_RING_SIZE & (ECO_LOG_RING_SIZE - 1)) == 0, "ECO_LOG_RING_SIZE muss eine Zweierpotenz sein");
+static_assert(ECO_LOG_MAX_ARGS <= 255, "Argumentlänge muss in 8 Bit passen");
+
+#define ECO_LOG_MAGIC 0xEC0106A5
+
+// Kopf je Eintrag, danach len Bytes gepackte Argumente
+struct RecordHeader {
+  uint32_t    ms;
+  const char* fmt;
+  uint8_t     level;
+  uint8_t     len;
+};
+
+// head/tail laufen fortlaufend hoch, Position im Puffer = Wert % ECO_LOG_RING_SIZE
+struct LogRing {
+  uint32_t magic;
+  uint32_t build;    // Format-Zeiger gelten nur für dieselbe Firmware
+  uint32_t head;
+  uint32_t tail;
+  uint32_t dropped;  // wegen Platzmangel verworfene Einträge
+  uint8_t  data[ECO_LOG_RING_SIZE];
+};
+
+RTC_NOINIT_ATTR static LogRing ring;
+static portMUX_TYPE ringMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Erste Bytes des ELF-SHA256 der laufenden Firmware
+static uint32_t buildId() {
+  static uint32_t id = 0;
+  if (id == 0) {
+#ifdef ECO_LOG_APP_DESC
+    memcpy(&id, ECO_LOG_APP_DESC()->app_elf_sha256, sizeof(id));
+#endif
+    id |= 1;
+  }
+  return id;
+}
+
+// Nach Stromausfall oder neuer Firmware ist der Inhalt ungültig
+static void ringCheck() {
+  if (ring.magic != ECO_LOG_MAGIC || ring.build != buildId() || ring.head - ring.tail > ECO_LOG_RING_SIZE) {
+    ring.magic = ECO_LOG_MAGIC;
+    ring.build = buildId();
+    ring.head = ring.tail = 0;
+    ring.dropped = 0;
+  }
+}
+
+static void ringPut(const void* src, uint32_t n) {
+  const uint8_t* s = (const uint8_t*)src;
+  for (uint32_t i = 0; i < n; ++i) ring.data[ring.head++ % ECO_LOG_RING_SIZE] = s[i];
+}
+
+static void ringGet(uint32_t& pos, void* dst, uint32_t n) {
+  uint8_t* d = (uint8_t*)dst;
+  for (uint32_t i = 0; i < n; ++i) d[i] = ring.data[pos++ % ECO_LOG_RING_SIZE];
+}
+
+void ecolog::commit(uint8_t level, const char* fmt, const uint8_t* args, size_t len) {
+  RecordHeader hdr = { (uint32_t)millis(), fmt, level, (uint8_t)len };
+  portENTER_CRITICAL(&ringMux);
+  ringCheck();
+  while (ECO_LOG_RING_SIZE - (ring.head - ring.tail) < sizeof(hdr) + len) {
+    RecordHeader old; // ältesten Eintrag verwerfen
+    uint32_t pos = ring.tail;
+    ringGet(pos, &old, sizeof(old));
+    ring.tail = pos + old.len;
+    ++ring.dropped;
+  }
+  ringPut(&hdr, sizeof(hdr));
+  ringPut(args, len);
+  portEXIT_CRITICAL(&ringMux);
+}
+
+// Liest das nächste Argument (n Bytes); fehlt es (gekürzter Eintrag), bleibt dst 0
+static void takeArg(const uint8_t*& a, const uint8_t* end, void* dst, size_t n) {
+  memset(dst, 0, n);
+  if ((size_t)(end - a) >= n) memcpy(dst, a, n);
+  a = (size_t)(end - a) >= n ? a + n : end;
+}
+
+// Setzt einen Eintrag mit dem gespeicherten Format-String zusammen. Jede
+// Umwandlung wird einzeln an snprintf übergeben, mit dem Typ, den pack()
+// für das Argument gespeichert hat.
+static void formatRecord(const RecordHeader& hdr, const uint8_t* args, char* out, size_t size) {
+  static const char LEVELS[] = "-EWID";
+  int n = snprintf(out, size, "%8lu %c ", (unsigned long)hdr.ms, LEVELS[hdr.level <= ECO_LOG_DEBUG ? hdr.level : 0]);
+  const uint8_t* a = args;
+  const uint8_t* end = args + hdr.len;
+  for (const char* f = hdr.fmt; *f != '\0' && n < (int)size - 1; ) {
+    if (*f != '%' || f[1] == '%') {
+      out[n++] = *f;
+      f += *f == '%' ? 2 : 1;
+      continue;
+    }
+    char spec[16];
+    uint8_t s = 0, longs = 0;
+    spec[s++] = *f++;
+    while (*f != '\0' && strchr("diouxXcsfFeEgGp", *f) == nullptr && s < sizeof(spec) - 2) {
+      if (*f == 'l') ++longs;
+      spec[s++] = *f++;
+    }
+    if (*f == '\0') break;
+    char conv = *f++;
+    spec[s++] = conv;
+    spec[s] = '\0';
+
+    size_t room = size - n;
+    int w;
+    if (conv == 's') {
+      char str[ECO_LOG_MAX_STR + 1];
+      uint8_t len = 0;
+      takeArg(a, end, &len, 1);
+      if (len > end - a) len = end - a;
+      memcpy(str, a, len);
+      str[len] = '\0';
+      a += len;
+      w = snprintf(out + n, room, spec, str);
+    } else if (strchr("fFeEgG", conv) != nullptr) {
+      double v;
+      takeArg(a, end, &v, sizeof(v));
+      w = snprintf(out + n, room, spec, v);
+    } else if (longs >= 2) {
+      uint64_t v;
+      takeArg(a, end, &v, sizeof(v));
+      w = snprintf(out + n, room, spec, (unsigned long long)v);
+    } else {
+      uint32_t v;
+      takeArg(a, end, &v, sizeof(v));
+      bool sign = conv == 'd' || conv == 'i';
+      if (conv == 'p') {
+        w = snprintf(out + n, room, spec, (void*)(uintptr_t)v);
+      } else if (longs == 1) {
+        w = sign ? snprintf(out + n, room, spec, (long)(int32_t)v) : snprintf(out + n, room, spec, (unsigned long)v);
+      } else {
+        w = snprintf(out + n, room, spec, v);
+      }
+    }
+    if (w > 0) n += w < (int)room ? w : (int)room - 1;
+  }
+  out[n < (int)size ? n : size - 1] = '\0';
+}
+
+void ecoLogDump(void (*out)(const char* line)) {
+  char line[160];
+  portENTER_CRITICAL(&ringMux);
+  ringCheck();
+  uint32_t pos = ring.tail;
+  uint32_t used = ring.head - ring.tail, dropped = ring.dropped;
+  portEXIT_CRITICAL(&ringMux);
+  snprintf(line, sizeof(line), "--- Log-Ringpuffer: %lu/%u Bytes, %lu Eintraege verworfen ---",
+           (unsigned long)used, ECO_LOG_RING_SIZE, (unsigned long)dropped);
+  out(line);
+
+  for (;;) {
+    RecordHeader hdr;
+    uint8_t args[ECO_LOG_MAX_ARGS];
+    portENTER_CRITICAL(&ringMux);
+    if ((int32_t)(pos - ring.tail) < 0) pos = ring.tail; // beim Ausgeben überschrieben
+    bool more = pos != ring.head;
+    if (more) {
+      ringGet(pos, &hdr, sizeof(hdr));
+      ringGet(pos, args, hdr.len);
+    }
+    portEXIT_CRITICAL(&ringMux);
+    if (!more) break;
+    formatRecord(hdr, args, line, sizeof(line));
+    out(line);
+  }
+
+  portENTER_CRITICAL(&ringMux);
+  if ((int32_t)(pos - ring.tail) > 0) ring.tail = pos;
+  ring.dropped = 0;
+  portEXIT_CRITICAL(&ringMux);
+}
+
+#else
+
+void ecoLogDump(void (*)(const char*)) {}
+
+#endif
@@ -0,0 +1,148 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – Logging mit Stufen zur Übersetzungszeit
+//  ECO_LOG_LEVEL (build_flags): 0 = aus, 1 = Fehler, 2 = Warnungen,
+//  3 = Info, 4 = Debug. Aufrufe oberhalb der Stufe werden samt ihrer
+//  Argumente nicht übersetzt.
+//  ECO_LOG_BACKEND: ECO_LOG_SERIAL gibt sofort auf Serial aus,
+//  ECO_LOG_RING legt binäre Einträge (Zeit, Zeiger auf den Format-
+//  String, gepackte Argumente) in einem Ringpuffer ab. Formatiert wird
+//  erst bei ecoLogDump(), auf dem Gerät im RTC-Speicher, der Deep-Sleep,
+//  Watchdog und Absturz übersteht.
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_ECO_LOG_H
+#define ECOSNAP_ECO_LOG_H
+
+#include <Arduino.h>
+
+#define ECO_LOG_NONE  0
+#define ECO_LOG_ERROR 1
+#define ECO_LOG_WARN  2
+#define ECO_LOG_INFO  3
+#define ECO_LOG_DEBUG 4
+
+#define ECO_LOG_SERIAL 0
+#define ECO_LOG_RING   1
+
+#ifndef ECO_LOG_LEVEL
+#define ECO_LOG_LEVEL ECO_LOG_INFO
+#endif
+#ifndef ECO_LOG_BACKEND
+#define ECO_LOG_BACKEND ECO_LOG_SERIAL
+#endif
+#ifndef ECO_LOG_RING_SIZE
+#define ECO_LOG_RING_SIZE 2048   // Bytes, Zweierpotenz
+#endif
+#define ECO_LOG_MAX_ARGS 96      // Bytes Argumente je Eintrag, darüber wird gekürzt
+#define ECO_LOG_MAX_STR 40       // Zeichen je %s-Argument im Ringpuffer
+
+// Für Code, der nur dem Log dient (z.B. Messungen nur für eine Ausgabe)
+#define ECO_LOG_ENABLED(level) (ECO_LOG_LEVEL >= (level))
+// Serial wird nur gebraucht, wenn direkt ausgegeben wird
+#define ECO_LOG_USES_SERIAL (ECO_LOG_BACKEND == ECO_LOG_SERIAL && ECO_LOG_LEVEL > ECO_LOG_NONE)
+
+#if ECO_LOG_BACKEND == ECO_LOG_RING
+#define ECO_LOG_WRITE(level, fmt, ...) ecoLogRecord(level, fmt, ##__VA_ARGS__)
+#else
+#define ECO_LOG_WRITE(level, fmt, ...) Serial.printf(fmt "\n", ##__VA_ARGS__)
+#endif
+
+// Abgeschaltete Stufen: Argumente werden weder ausgewertet noch übersetzt,
+// gelten aber als benutzt (keine Warnungen für reine Log-Variablen)
+template <typename... A>
+inline void ecoLogDiscard(const char*, const A&...) {}
+#define ECO_LOG_DISCARD(fmt, ...) do { if (false) ecoLogDiscard(fmt, ##__VA_ARGS__); } while (0)
+
+#if ECO_LOG_ENABLED(ECO_LOG_ERROR)
+#define ECO_LOGE(fmt, ...) ECO_LOG_WRITE(ECO_LOG_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define ECO_LOGE(fmt, ...) ECO_LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+#if ECO_LOG_ENABLED(ECO_LOG_WARN)
+#define ECO_LOGW(fmt, ...) ECO_LOG_WRITE(ECO_LOG_WARN, fmt, ##__VA_ARGS__)
+#else
+#define ECO_LOGW(fmt, ...) ECO_LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+#if ECO_LOG_ENABLED(ECO_LOG_INFO)
+#define ECO_LOGI(fmt, ...) ECO_LOG_WRITE(ECO_LOG_INFO, fmt, ##__VA_ARGS__)
+#else
+#define ECO_LOGI(fmt, ...) ECO_LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+#if ECO_LOG_ENABLED(ECO_LOG_DEBUG)
+#define ECO_LOGD(fmt, ...) ECO_LOG_WRITE(ECO_LOG_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define ECO_LOGD(fmt, ...) ECO_LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+
+#if ECO_LOG_USES_SERIAL
+#define ECO_LOG_FLUSH() Serial.flush()
+#else
+#define ECO_LOG_FLUSH() do {} while (0)
+#endif
+
+// Gibt den Ringpuffer formatiert zeilenweise aus und leert ihn (ohne Ringpuffer: nichts)
+void ecoLogDump(void (*out)(const char* line));
+
+#if ECO_LOG_BACKEND == ECO_LOG_RING
+#include <type_traits>
+
+namespace ecolog {
+
+struct Packer {
+  uint8_t* p;
+  uint8_t* end;
+};
+
+inline void put(Packer& pk, const void* v, size_t n) {
+  if (n > (size_t)(pk.end - pk.p)) n = pk.end - pk.p;
+  memcpy(pk.p, v, n);
+  pk.p += n;
+}
+
+// Ganzzahlen und Zeiger: 4 Bytes (64 Bit: 8), Gleitkomma: double, Strings: Länge + Zeichen
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+pack(Packer& pk, T v) {
+  if (sizeof(T) > 4) {
+    uint64_t x = (uint64_t)v;
+    put(pk, &x, sizeof(x));
+  } else {
+    uint32_t x = (uint32_t)v;
+    put(pk, &x, sizeof(x));
+  }
+}
+inline void pack(Packer& pk, double v) { put(pk, &v, sizeof(v)); }
+inline void pack(Packer& pk, const char* s) {
+  uint8_t n = 0;
+  if (s != nullptr) while (n < ECO_LOG_MAX_STR && s[n] != '\0') ++n;
+  put(pk, &n, 1);
+  put(pk, s, n);
+}
+inline void pack(Packer& pk, char* s) { pack(pk, (const char*)s); }
+template <typename T>
+inline void pack(Packer& pk, const T* p) {
+  uint32_t x = (uint32_t)(uintptr_t)p;
+  put(pk, &x, sizeof(x));
+}
+
+inline void packAll(Packer&) {}
+template <typename T, typename... R>
+inline void packAll(Packer& pk, T v, R... rest) {
+  pack(pk, v);
+  packAll(pk, rest...);
+}
+
+void commit(uint8_t level, const char* fmt, const uint8_t* args, size_t len);
+
+} // namespace ecolog
+
+// fmt muss ein String-Literal sein: gespeichert wird nur der Zeiger
+template <typename... A>
+inline void ecoLogRecord(uint8_t level, const char* fmt, A... args) {
+  uint8_t buf[ECO_LOG_MAX_ARGS];
+  ecolog::Packer pk = { buf, buf + sizeof(buf) };
+  ecolog::packAll(pk, args...);
+  ecolog::commit(level, fmt, buf, pk.p - buf);
+}
+#endif
+
+#endif // ECOSNAP_ECO_LOG_H
@@ -0,0 +1,276 @@
+#include "EspNowProtocol.h"
+#include "Fec.h"
+#include <string.h>
+#if __has_include(<esp_crc.h>)
+#include <esp_crc.h>
+#endif
+
+uint32_t espNowCrc32(uint32_t crc, const uint8_t* buf, uint32_t len) {
+#if __has_include(<esp_crc.h>)
+  return esp_crc32_le(crc, buf, len);
+#else
+  // Host-Build (native): tabellengestützt, gleiches Ergebnis wie die ROM-Funktion
+  static uint32_t table[256];
+  if (table[1] == 0) {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (uint8_t k = 0; k < 8; ++k) c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1)));
+      table[i] = c;
+    }
+  }
+  crc = ~crc;
+  while (len--) crc = (crc >> 8) ^ table[(crc ^ *buf++) & 0xFF];
+  return ~crc;
+#endif
+}
+
+// Länge der Erweiterung zu flag an Position p; 0 wenn unbekannt
+static uint8_t extSize(uint8_t flag, const uint8_t* p, uint8_t avail) {
+  switch (flag) {
+    case ESP_NOW_FLAG_WAKE_PROFILE: return avail >= 1 ? 1 + 2 * p[0] : 0; // Anzahl + je 2 Bytes
+    case ESP_NOW_FLAG_CHUNK_CRC:
+    case ESP_NOW_FLAG_IMAGE_CRC:    return ESP_NOW_CRC_SIZE;
+    case ESP_NOW_FLAG_FEC:          return ESP_NOW_FEC_EXT_SIZE;
+    case ESP_NOW_FLAG_LIVE:         return ESP_NOW_LIVE_EXT_SIZE;
+  }
+  return 0;
+}
+
+const uint8_t* espNowFindExt(const EspNowChunk& chunk, uint8_t flag) {
+  if (!(chunk.flags & flag) || chunk.ext == nullptr) return nullptr;
+  uint8_t pos = 0;
+  for (uint8_t bit = 1; ; bit <<= 1) {
+    if (!(chunk.flags & bit)) continue;
+    uint8_t n = extSize(bit, chunk.ext + pos, chunk.ext_len - pos);
+    if (n == 0 || pos + n > chunk.ext_len) return nullptr; // unbekannte Erweiterung davor
+    if (bit == flag) return chunk.ext + pos;
+    pos += n;
+  }
+}
+
+bool espNowParseChunk(const uint8_t* packet, int len, EspNowChunk& out) {
+  if (len >= ESP_NOW_CHUNK_V2_HEADER_SIZE && packet[0] == ESP_NOW_CHUNK_MAGIC &&
+      packet[1] == ESP_NOW_PROTOCOL_V2) {
+    esp_now_chunk_v2_hdr_t hdr;
+    memcpy(&hdr, packet, sizeof(hdr));
+    if (hdr.header_len >= ESP_NOW_CHUNK_V2_HEADER_SIZE && hdr.header_len + hdr.data_len == len &&
+        hdr.chunk_size > 0) {
+      out.version = ESP_NOW_PROTOCOL_V2;
+      out.flags = hdr.flags;
+      out.image_id = hdr.image_id;
+      out.total_size = hdr.total_size;
+      out.chunk_index = hdr.chunk_index;
+      out.total_chunks = hdr.total_chunks;
+      out.chunk_size = hdr.chunk_size;
+      out.data_len = hdr.data_len;
+      out.vbat_mv = hdr.vbat_mv;
+      out.ext = packet + ESP_NOW_CHUNK_V2_HEADER_SIZE;
+      out.ext_len = hdr.header_len - ESP_NOW_CHUNK_V2_HEADER_SIZE;
+      out.data = packet + hdr.header_len;
+      out.crc_ok = true;
+      out.image_crc = 0;
+      if (const uint8_t* crc = espNowFindExt(out, ESP_NOW_FLAG_CHUNK_CRC)) {
+        uint32_t expected;
+        memcpy(&expected, crc, ESP_NOW_CRC_SIZE);
+        uint32_t pos = crc - packet;
+        uint32_t actual = espNowCrc32(0, packet, pos);
+        actual = espNowCrc32(actual, crc + ESP_NOW_CRC_SIZE, len - pos - ESP_NOW_CRC_SIZE);
+        out.crc_ok = actual == expected;
+      } else if (out.flags & ESP_NOW_FLAG_CHUNK_CRC) {
+        return false;
+      }
+      if (const uint8_t* crc = espNowFindExt(out, ESP_NOW_FLAG_IMAGE_CRC)) {
+        memcpy(&out.image_crc, crc, ESP_NOW_CRC_SIZE);
+      } else if (out.flags & ESP_NOW_FLAG_IMAGE_CRC) {
+        return false;
+      }
+      out.fec_k = out.fec_m = 0;
+      out.fec_parity = ESP_NOW_FEC_DATA;
+      if (const uint8_t* fec = espNowFindExt(out, ESP_NOW_FLAG_FEC)) {
+        out.fec_k = fec[0];
+        out.fec_m = fec[1];
+        out.fec_parity = fec[2];
+        if (out.fec_k == 0 || out.fec_k > ESP_NOW_FEC_MAX_K || out.fec_m > ESP_NOW_FEC_MAX_M) return false;
+        if (out.fec_parity != ESP_NOW_FEC_DATA &&
+            (out.fec_parity >= out.fec_m || out.chunk_index % out.fec_k != 0 || out.data_len != out.chunk_size)) {
+          return false;
+        }
+      } else if (out.flags & ESP_NOW_FLAG_FEC) {
+        return false;
+      }
+      return out.total_chunks > 0 && out.chunk_index < out.total_chunks;
+    }
+    // Sonst: zufällig passende Bytes eines v1-Chunks, unten als v1 prüfen
+  }
+
+  if (len < ESP_NOW_CHUNK_HEADER_SIZE) return false;
+  const esp_now_image_chunk_t* v1 = reinterpret_cast<const esp_now_image_chunk_t*>(packet);
+  if (len != ESP_NOW_CHUNK_HEADER_SIZE + v1->data_len) return false;
+  out.version = ESP_NOW_PROTOCOL_V1;
+  out.flags = 0;
+  out.image_id = v1->image_id;
+  out.total_size = v1->total_size;
+  out.chunk_index = v1->chunk_index;
+  out.total_chunks = v1->total_chunks;
+  out.chunk_size = ESP_NOW_MAX_DATA_PER_CHUNK;
+  out.data_len = v1->data_len;
+  out.vbat_mv = (v1->vbat_mv_high << 8) | v1->vbat_mv_low;
+  out.ext = nullptr;
+  out.ext_len = 0;
+  out.crc_ok = true;
+  out.image_crc = 0;
+  out.fec_k = out.fec_m = 0;
+  out.fec_parity = ESP_NOW_FEC_DATA;
+  out.data = v1->data;
+  return out.total_chunks > 0 && out.chunk_index < out.total_chunks;
+}
+
+bool espNowTxImageInit(EspNowTxImage& img, const uint8_t* buf, uint32_t len, uint32_t imageId,
+                       uint16_t vbatMv, uint8_t version, uint16_t maxPayload, bool crc,
+                       uint8_t extFlags, const uint8_t* ext, uint8_t extLen,
+                       uint8_t fecK, uint8_t fecM) {
+  img.buf = buf;
+  img.len = len;
+  img.image_id = imageId;
+  img.vbat_mv = vbatMv;
+  img.version = version;
+  img.ext_flags = 0;
+  img.ext_len = 0;
+  img.ext_head_len = 0;
+  img.crc = false;
+  img.image_crc = 0;
+  img.fec_k = img.fec_m = 0;
+  if (version == ESP_NOW_PROTOCOL_V1) {
+    img.chunk_size = ESP_NOW_MAX_DATA_PER_CHUNK; // data_len ist in v1 nur 8 Bit breit
+  } else {
+    if (maxPayload > ESP_NOW_MAX_PAYLOAD_LARGE) maxPayload = ESP_NOW_MAX_PAYLOAD_LARGE;
+    if (ext != nullptr && extLen > 0 && extLen <= ESP_NOW_MAX_HEADER_EXT) {
+      img.ext_flags = extFlags;
+      img.ext_len = extLen;
+      memcpy(img.ext, ext, extLen);
+      // Erweiterungen mit kleinerem Flag als die Chunk-CRC stehen vor ihr, der Rest nach FEC
+      uint8_t pos = 0;
+      for (uint8_t bit = 1; bit != 0 && pos < extLen; bit <<= 1) {
+        if (!(extFlags & bit)) continue;
+        uint8_t n = extSize(bit, ext + pos, extLen - pos);
+        if (n == 0 || bit >= ESP_NOW_FLAG_CHUNK_CRC) break;
+        pos += n;
+      }
+      img.ext_head_len = pos;
+    }
+    uint8_t reserve = img.ext_len;
+    if (crc) {
+      img.crc = true;
+      img.image_crc = espNowCrc32(0, buf, len);
+      reserve += 2 * ESP_NOW_CRC_SIZE; // Chunk 0 trägt beide CRCs
+    }
+    if (fecM > 0 && fecK > 0) {
+      img.fec_k = fecK > ESP_NOW_FEC_MAX_K ? ESP_NOW_FEC_MAX_K : fecK;
+      img.fec_m = fecM > ESP_NOW_FEC_MAX_M ? ESP_NOW_FEC_MAX_M : fecM;
+      reserve += ESP_NOW_FEC_EXT_SIZE;
+    }
+    // Zu kleine Paketgröße (z.B. aus einer fehlerhaften CAPS-Nachricht) ergäbe chunk_size 0
+    // oder einen Unterlauf: dann die Standardgröße, die jeder Empfänger annimmt
+    if (maxPayload < ESP_NOW_CHUNK_V2_HEADER_SIZE + reserve + 1) maxPayload = ESP_NOW_MAX_PAYLOAD;
+    img.chunk_size = maxPayload - ESP_NOW_CHUNK_V2_HEADER_SIZE - reserve;
+  }
+  uint32_t chunks = (len + img.chunk_size - 1) / img.chunk_size;
+  img.total_chunks = chunks;
+  uint32_t packets = chunks;
+  if (img.fec_m > 0) packets += (chunks + img.fec_k - 1) / img.fec_k * img.fec_m;
+  img.total_packets = packets;
+  return len > 0 && packets <= ESP_NOW_MAX_CHUNKS;
+}
+
+// Parität j der Gruppe ab Chunk first: Summe coef(j, i) * Daten-Chunk i über GF(256)
+static void buildParity(const EspNowTxImage& img, uint16_t first, uint8_t j, uint8_t* out) {
+  memset(out, 0, img.chunk_size);
+  for (uint8_t i = 0; i < img.fec_k && first + i < img.total_chunks; ++i) {
+    uint32_t offset = (uint32_t)(first + i) * img.chunk_size;
+    uint32_t n = img.len - offset;
+    if (n > img.chunk_size) n = img.chunk_size;
+    fecMulAdd(out, img.buf + offset, fecCoef(j, i), n);
+  }
+}
+
+size_t espNowBuildChunk(const EspNowTxImage& img, uint16_t seq, uint8_t* out) {
+  uint16_t idx = seq;
+  uint8_t parity = ESP_NOW_FEC_DATA;
+  if (img.fec_m > 0) {
+    uint16_t group = seq / (img.fec_k + img.fec_m);
+    uint16_t first = group * img.fec_k;
+    uint16_t dataInGroup = img.total_chunks - first < img.fec_k ? img.total_chunks - first : img.fec_k;
+    uint16_t pos = seq - group * (img.fec_k + img.fec_m);
+    idx = first + (pos < dataInGroup ? pos : 0);
+    if (pos >= dataInGroup) parity = pos - dataInGroup;
+  }
+  uint32_t offset = (uint32_t)idx * img.chunk_size;
+  uint32_t n = img.len - offset;
+  if (n > img.chunk_size || parity != ESP_NOW_FEC_DATA) n = img.chunk_size;
+
+  if (img.version == ESP_NOW_PROTOCOL_V1) {
+    esp_now_image_chunk_t* c = reinterpret_cast<esp_now_image_chunk_t*>(out);
+    c->image_id = img.image_id;
+    c->total_size = img.len;
+    c->chunk_index = idx;
+    c->total_chunks = img.total_chunks;
+    c->data_len = n;
+    c->vbat_mv_high = (img.vbat_mv >> 8) & 0xFF;
+    c->vbat_mv_low = img.vbat_mv & 0xFF;
+    memcpy(c->data, img.buf + offset, n);
+    return ESP_NOW_CHUNK_HEADER_SIZE + n;
+  }
+
+  // Erweiterungen in Flag-Reihenfolge: Profil (Chunk 0), Chunk-CRC, Bild-CRC (Chunk 0), FEC,
+  // Live (Chunk 0)
+  bool first = idx == 0 && parity == ESP_NOW_FEC_DATA;
+  uint8_t extHead = first ? img.ext_head_len : 0;
+  uint8_t extTail = first ? img.ext_len - img.ext_head_len : 0;
+  uint8_t flags = first && img.ext_len ? img.ext_flags : 0;
+  uint8_t crcPos = ESP_NOW_CHUNK_V2_HEADER_SIZE + extHead;
+  uint8_t headerLen = crcPos;
+  if (img.crc) {
+    flags |= ESP_NOW_FLAG_CHUNK_CRC;
+    headerLen += ESP_NOW_CRC_SIZE;
+    if (first) {
+      flags |= ESP_NOW_FLAG_IMAGE_CRC;
+      memcpy(out + headerLen, &img.image_crc, ESP_NOW_CRC_SIZE);
+      headerLen += ESP_NOW_CRC_SIZE;
+    }
+  }
+  if (img.fec_m > 0) {
+    flags |= ESP_NOW_FLAG_FEC;
+    out[headerLen++] = img.fec_k;
+    out[headerLen++] = img.fec_m;
+    out[headerLen++] = parity;
+  }
+  memcpy(out + headerLen, img.ext + extHead, extTail);
+  headerLen += extTail;
+
+  esp_now_chunk_v2_hdr_t hdr;
+  hdr.magic = ESP_NOW_CHUNK_MAGIC;
+  hdr.version = ESP_NOW_PROTOCOL_V2;
+  hdr.flags = flags;
+  hdr.header_len = headerLen;
+  hdr.image_id = img.image_id;
+  hdr.total_size = img.len;
+  hdr.chunk_index = idx;
+  hdr.total_chunks = img.total_chunks;
+  hdr.chunk_size = img.chunk_size;
+  hdr.data_len = n;
+  hdr.vbat_mv = img.vbat_mv;
+  memcpy(out, &hdr, sizeof(hdr));
+  memcpy(out + sizeof(hdr), img.ext, extHead);
+  if (parity != ESP_NOW_FEC_DATA) {
+    buildParity(img, idx, parity, out + hdr.header_len);
+  } else {
+    memcpy(out + hdr.header_len, img.buf + offset, n);
+  }
+  size_t total = hdr.header_len + n;
+  if (img.crc) {
+    uint32_t crc = espNowCrc32(0, out, crcPos);
+    crc = espNowCrc32(crc, out + crcPos + ESP_NOW_CRC_SIZE, total - crcPos - ESP_NOW_CRC_SIZE);
+    memcpy(out + crcPos, &crc, ESP_NOW_CRC_SIZE);
+  }
+  return total;
+}
@@ -0,0 +1,393 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – gemeinsames ESP-NOW Übertragungsprotokoll
+//  Wird von Sender (sender_app) und Empfänger (receiver_app) genutzt
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_ESPNOW_PROTOCOL_H
+#define ECOSNAP_ESPNOW_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#if __has_include(<esp_now.h>)
+#include <esp_now.h>
+#endif
+
+// Maximale ESP-NOW Nutzlast pro Paket (IDF: ESP_NOW_MAX_DATA_LEN)
+#define ESP_NOW_MAX_PAYLOAD 250
+
+// Große Pakete (ESP-NOW v2, IDF >= 5.4: ESP_NOW_MAX_DATA_LEN_V2 = 1470 Bytes), sonst wie oben
+#if defined(ESP_NOW_MAX_DATA_LEN_V2)
+#define ESP_NOW_MAX_PAYLOAD_LARGE ESP_NOW_MAX_DATA_LEN_V2
+#else
+#define ESP_NOW_MAX_PAYLOAD_LARGE ESP_NOW_MAX_PAYLOAD
+#endif
+
+// ───────── Protokoll v1 (ursprüngliches Format, ohne Versionsfeld) ─────────
+// Header: image_id (4), total_size (4), chunk_index (2), total_chunks (2), data_len (1), vbat_mv_high (1), vbat_mv_low (1) = 15 Bytes
+#define ESP_NOW_CHUNK_HEADER_SIZE 15
+#define ESP_NOW_MAX_DATA_PER_CHUNK (ESP_NOW_MAX_PAYLOAD - ESP_NOW_CHUNK_HEADER_SIZE)
+
+// Obergrenze für die Anzahl Chunks pro Bild (bestimmt die Größe der Chunk-Bitmaps)
+#define ESP_NOW_MAX_CHUNKS 2048
+
+typedef struct __attribute__((packed)) esp_now_image_chunk_t {
+    uint32_t image_id;
+    uint32_t total_size;
+    uint16_t chunk_index;
+    uint16_t total_chunks;
+    uint8_t  data_len;
+    uint8_t  vbat_mv_high;
+    uint8_t  vbat_mv_low;
+    uint8_t  data[ESP_NOW_MAX_DATA_PER_CHUNK];
+} esp_now_image_chunk_t;
+
+// Layout-Prüfungen gelten für Sender und Empfänger gleichermaßen (gemeinsamer Header)
+static_assert(offsetof(esp_now_image_chunk_t, total_size) == 4 && offsetof(esp_now_image_chunk_t, chunk_index) == 8 &&
+              offsetof(esp_now_image_chunk_t, total_chunks) == 10 && offsetof(esp_now_image_chunk_t, data_len) == 12 &&
+              offsetof(esp_now_image_chunk_t, vbat_mv_high) == 13, "v1-Headerlayout darf sich nicht ändern");
+static_assert(offsetof(esp_now_image_chunk_t, data) == ESP_NOW_CHUNK_HEADER_SIZE, "Chunk-Header muss 15 Bytes lang sein");
+static_assert(sizeof(esp_now_image_chunk_t) == ESP_NOW_MAX_PAYLOAD, "Chunk muss genau in ein ESP-NOW Paket passen");
+
+// ───────── Protokoll v2 ─────────
+// Beginnt mit Magic-Byte und Version, 16-Bit Datenlänge und frei wählbarer Chunkgröße,
+// damit große ESP-NOW Pakete und Bilder ohne 50-KB-Grenze möglich sind.
+// header_len erlaubt spätere Erweiterungen; die Nutzdaten beginnen immer bei header_len.
+#define ESP_NOW_CHUNK_MAGIC 0xE5
+#define ESP_NOW_PROTOCOL_V1 1
+#define ESP_NOW_PROTOCOL_V2 2
+
+// Header: magic (1), version (1), flags (1), header_len (1), image_id (4), total_size (4),
+//         chunk_index (2), total_chunks (2), chunk_size (2), data_len (2), vbat_mv (2) = 22 Bytes
+#define ESP_NOW_CHUNK_V2_HEADER_SIZE 22
+
+typedef struct __attribute__((packed)) esp_now_chunk_v2_hdr_t {
+    uint8_t  magic;
+    uint8_t  version;
+    uint8_t  flags;        // ESP_NOW_FLAG_*: welche Erweiterungen folgen
+    uint8_t  header_len;   // Headerlänge inkl. Erweiterungen
+    uint32_t image_id;
+    uint32_t total_size;
+    uint16_t chunk_index;
+    uint16_t total_chunks;
+    uint16_t chunk_size;   // Nutzdaten pro Chunk (alle außer dem letzten); Offset = index * chunk_size
+    uint16_t data_len;
+    uint16_t vbat_mv;
+} esp_now_chunk_v2_hdr_t;
+
+static_assert(sizeof(esp_now_chunk_v2_hdr_t) == ESP_NOW_CHUNK_V2_HEADER_SIZE, "v2-Header muss 22 Bytes lang sein");
+static_assert(offsetof(esp_now_chunk_v2_hdr_t, version) == 1 && offsetof(esp_now_chunk_v2_hdr_t, flags) == 2 &&
+              offsetof(esp_now_chunk_v2_hdr_t, header_len) == 3 && offsetof(esp_now_chunk_v2_hdr_t, image_id) == 4 &&
+              offsetof(esp_now_chunk_v2_hdr_t, total_size) == 8 && offsetof(esp_now_chunk_v2_hdr_t, chunk_index) == 12 &&
+              offsetof(esp_now_chunk_v2_hdr_t, total_chunks) == 14 && offsetof(esp_now_chunk_v2_hdr_t, chunk_size) == 16 &&
+              offsetof(esp_now_chunk_v2_hdr_t, data_len) == 18 && offsetof(esp_now_chunk_v2_hdr_t, vbat_mv) == 20,
+              "v2-Headerlayout darf sich nicht ändern");
+
+// Header-Erweiterungen folgen direkt auf die 22 Bytes, in der Reihenfolge der Flag-Bits.
+// Empfänger ohne Kenntnis einer Erweiterung überspringen sie über header_len.
+#define ESP_NOW_FLAG_WAKE_PROFILE 0x01 // Wachzeit-Profil des Senders (nur Chunk 0), siehe WakeProfile.h
+#define ESP_NOW_FLAG_CHUNK_CRC    0x02 // CRC32 über das ganze Paket ohne das CRC-Feld (jeder Chunk)
+#define ESP_NOW_FLAG_IMAGE_CRC    0x04 // CRC32 über das vollständige Bild (nur Chunk 0)
+#define ESP_NOW_FLAG_FEC          0x08 // FEC-Gruppe: K, M, Paritätsnummer (jedes Paket eines FEC-Bildes)
+#define ESP_NOW_FLAG_LIVE         0x10 // Live-Bild: Bildnummer und Alter seit der Aufnahme (nur Chunk 0)
+#define ESP_NOW_CRC_SIZE 4
+#define ESP_NOW_FEC_EXT_SIZE 3
+#define ESP_NOW_LIVE_EXT_SIZE 4
+#define ESP_NOW_FEC_DATA 0xFF          // Paritätsnummer eines Daten-Chunks
+#define ESP_NOW_MAX_HEADER_EXT 32
+static_assert(ESP_NOW_CHUNK_V2_HEADER_SIZE + ESP_NOW_MAX_HEADER_EXT + 2 * ESP_NOW_CRC_SIZE + ESP_NOW_FEC_EXT_SIZE <
+              ESP_NOW_MAX_PAYLOAD, "Alle Erweiterungen müssen auch in ein 250-Byte-Paket passen");
+
+// CRC32 (IEEE, wie zlib); auf dem ESP32 über die ROM-Funktion esp_crc32_le.
+// Verkettbar: espNowCrc32(espNowCrc32(0, a, n), b, m) == CRC über a und b.
+uint32_t espNowCrc32(uint32_t crc, const uint8_t* buf, uint32_t len);
+
+// Versionsunabhängige Sicht auf einen empfangenen Chunk
+struct EspNowChunk {
+  uint8_t  version;
+  uint8_t  flags;
+  uint32_t image_id;
+  uint32_t total_size;
+  uint16_t chunk_index;
+  uint16_t total_chunks;
+  uint16_t chunk_size;
+  uint16_t data_len;
+  uint16_t vbat_mv;
+  const uint8_t* ext;      // Header-Erweiterungen (nur v2), ext_len Bytes
+  uint8_t  ext_len;
+  bool     crc_ok;         // false nur bei vorhandener, aber falscher Chunk-CRC
+  uint32_t image_crc;      // gültig bei ESP_NOW_FLAG_IMAGE_CRC
+  uint8_t  fec_k;          // Daten-Chunks je FEC-Gruppe; 0 = Bild ohne FEC
+  uint8_t  fec_m;          // Paritäts-Chunks je Gruppe
+  uint8_t  fec_parity;     // Nummer der Parität oder ESP_NOW_FEC_DATA
+  const uint8_t* data;
+};
+
+// Erkennt v1/v2 und prüft Längen und Index; false bei ungültigem Paket.
+// Eine Chunk-CRC wird dabei geprüft (Ergebnis in crc_ok).
+// Paritäts-Chunks tragen als chunk_index den ersten Index ihrer Gruppe und
+// immer chunk_size Bytes (kürzere Daten-Chunks zählen als mit 0 aufgefüllt).
+bool espNowParseChunk(const uint8_t* packet, int len, EspNowChunk& out);
+
+// Letztes Paket eines Durchlaufs: letzter Daten-Chunk oder bei FEC die letzte
+// Parität der letzten Gruppe
+inline bool espNowIsLastPacket(const EspNowChunk& chunk) {
+  if (chunk.fec_k == 0 || chunk.fec_m == 0) return chunk.chunk_index == chunk.total_chunks - 1;
+  return chunk.fec_parity == chunk.fec_m - 1 && chunk.chunk_index + chunk.fec_k >= chunk.total_chunks;
+}
+
+// Sucht die Erweiterung zu flag in einem v2-Chunk; nullptr wenn nicht vorhanden
+const uint8_t* espNowFindExt(const EspNowChunk& chunk, uint8_t flag);
+
+// Live-Erweiterung: laufende Bildnummer und ms von der Aufnahme bis zum Sendebeginn
+// (je uint16, Little Endian)
+inline uint8_t espNowLivePack(uint16_t seq, uint16_t ageMs, uint8_t* out) {
+  out[0] = seq & 0xFF;
+  out[1] = seq >> 8;
+  out[2] = ageMs & 0xFF;
+  out[3] = ageMs >> 8;
+  return ESP_NOW_LIVE_EXT_SIZE;
+}
+
+// false, wenn der Chunk kein Live-Bild einleitet
+inline bool espNowLiveFromChunk(const EspNowChunk& chunk, uint16_t& seq, uint16_t& ageMs) {
+  const uint8_t* ext = espNowFindExt(chunk, ESP_NOW_FLAG_LIVE);
+  if (ext == nullptr) return false;
+  seq = ext[0] | (ext[1] << 8);
+  ageMs = ext[2] | (ext[3] << 8);
+  return true;
+}
+
+// Sendeseitige Beschreibung eines Bildes; Chunks werden direkt aus buf erzeugt
+struct EspNowTxImage {
+  const uint8_t* buf;
+  uint32_t len;
+  uint32_t image_id;
+  uint16_t vbat_mv;
+  uint8_t  version;
+  uint16_t chunk_size;
+  uint16_t total_chunks;
+  uint8_t  ext_flags;                    // Erweiterungen in Chunk 0
+  uint8_t  ext_len;
+  uint8_t  ext_head_len;                 // Teil von ext vor den CRCs (Flags unter CHUNK_CRC)
+  uint8_t  ext[ESP_NOW_MAX_HEADER_EXT];
+  bool     crc;                          // Chunk-CRC in jedem, Bild-CRC in Chunk 0
+  uint32_t image_crc;
+  uint8_t  fec_k;                        // 0 = ohne FEC
+  uint8_t  fec_m;
+  uint16_t total_packets;                // Daten- und Paritäts-Chunks
+};
+
+// Legt Chunkgröße und -anzahl für die gewählte Version und Paketgröße fest;
+// false, wenn das Bild mehr als ESP_NOW_MAX_CHUNKS Pakete bräuchte.
+// crc: CRC32 pro Chunk und über das Bild (nur v2).
+// ext/extLen: optionale Header-Erweiterungen für Chunk 0 (nur v2) in Flag-Reihenfolge,
+// ohne CRC und FEC (die ergänzt espNowBuildChunk an ihrer Stelle). Der Platz für alle
+// Erweiterungen wird bei der Chunkgröße berücksichtigt, damit alle Chunks gleich groß bleiben.
+// fecK/fecM: je fecK Daten-Chunks folgen fecM Paritäts-Chunks (nur v2, fecM 0 = ohne FEC).
+bool espNowTxImageInit(EspNowTxImage& img, const uint8_t* buf, uint32_t len, uint32_t imageId,
+                       uint16_t vbatMv, uint8_t version, uint16_t maxPayload, bool crc = false,
+                       uint8_t extFlags = 0, const uint8_t* ext = nullptr, uint8_t extLen = 0,
+                       uint8_t fecK = 0, uint8_t fecM = 0);
+
+// Pakete werden über eine Sendenummer seq (0..total_packets-1) angesprochen. Ohne FEC
+// ist seq der Chunk-Index; mit FEC folgen auf die Daten-Chunks jeder Gruppe deren Paritäten.
+inline uint16_t espNowTxDataSeq(const EspNowTxImage& img, uint16_t idx) {
+  if (img.fec_m == 0) return idx;
+  return (idx / img.fec_k) * (img.fec_k + img.fec_m) + idx % img.fec_k;
+}
+
+inline uint16_t espNowTxGroupOf(const EspNowTxImage& img, uint16_t seq) {
+  return img.fec_m == 0 ? seq : seq / (img.fec_k + img.fec_m);
+}
+
+// Schreibt Paket seq (Header + Daten bzw. Parität) nach out; liefert die Paketlänge
+size_t espNowBuildChunk(const EspNowTxImage& img, uint16_t seq, uint8_t* out);
+
+// ───────── Chunk-Bitmap ─────────
+// Ein Bit pro Chunk; wird vom Sender (bestätigte Chunks) und vom Empfänger
+// (empfangene Chunks) verwendet.
+class ChunkBitmap {
+public:
+  void reset(uint16_t total) {
+    _total = total > ESP_NOW_MAX_CHUNKS ? ESP_NOW_MAX_CHUNKS : total;
+    _count = 0;
+    for (uint16_t i = 0; i < WORDS; ++i) _words[i] = 0;
+  }
+
+  // Setzt das Bit; liefert false, wenn es bereits gesetzt war (Duplikat)
+  bool set(uint16_t idx) {
+    if (idx >= _total) return false;
+    uint32_t mask = 1UL << (idx & 31);
+    if (_words[idx >> 5] & mask) return false;
+    _words[idx >> 5] |= mask;
+    ++_count;
+    return true;
+  }
+
+  void clear(uint16_t idx) {
+    if (idx >= _total) return;
+    uint32_t mask = 1UL << (idx & 31);
+    if (!(_words[idx >> 5] & mask)) return;
+    _words[idx >> 5] &= ~mask;
+    --_count;
+  }
+
+  bool test(uint16_t idx) const {
+    return idx < _total && (_words[idx >> 5] & (1UL << (idx & 31)));
+  }
+
+  // Nächster gesetzter Index ab 'from'; _total wenn keiner
+  uint16_t nextSet(uint16_t from) const {
+    for (uint16_t i = from; i < _total; ) {
+      uint32_t w = _words[i >> 5] >> (i & 31);
+      if (w) {
+        uint16_t idx = i + __builtin_ctz(w);
+        return idx < _total ? idx : _total;
+      }
+      i = (i | 31) + 1;
+    }
+    return _total;
+  }
+
+  // Nächster nicht gesetzter Index ab 'from' (ohne Umlauf); _total wenn keiner
+  uint16_t nextClear(uint16_t from) const {
+    for (uint16_t i = from; i < _total; ) {
+      uint32_t w = ~_words[i >> 5] >> (i & 31);
+      if (w) {
+        uint16_t idx = i + __builtin_ctz(w);
+        return idx < _total ? idx : _total;
+      }
+      i = (i | 31) + 1;
+    }
+    return _total;
+  }
+
+  uint16_t total() const { return _total; }
+  uint16_t count() const { return _count; }
+  bool complete() const { return _count == _total; }
+
+private:
+  static constexpr uint16_t WORDS = (ESP_NOW_MAX_CHUNKS + 31) / 32;
+  uint32_t _words[WORDS] = {};
+  uint16_t _total = 0;
+  uint16_t _count = 0;
+};
+
+// ───────── Steuer-Nachrichten (Empfänger → Sender) ─────────
+// Beginnen immer mit ESP_NOW_CTRL_MAGIC und einem Typ-Byte.
+#define ESP_NOW_CTRL_MAGIC 0xEC
+
+enum : uint8_t {
+  ESP_NOW_CTRL_NACK = 0x01, // Liste fehlender Chunk-Bereiche; 0 Bereiche = Bild vollständig
+  ESP_NOW_CTRL_CAPS = 0x02, // Fähigkeiten des Empfängers (Protokollversion, Paketgröße, Merkmale)
+  ESP_NOW_CTRL_HEARTBEAT = 0x03, // Sender meldet sich ohne Bild (Szene unverändert)
+  ESP_NOW_CTRL_LINK = 0x04, // Empfangsqualität des letzten Bildes (RSSI, Verlust)
+};
+
+typedef struct __attribute__((packed)) esp_now_caps_t {
+  uint8_t  magic;
+  uint8_t  type;
+  uint8_t  max_version;   // höchste unterstützte Protokollversion
+  uint16_t max_payload;   // größte empfangbare ESP-NOW Nutzlast
+} esp_now_caps_t;
+
+static_assert(sizeof(esp_now_caps_t) == 5, "CAPS-Layout darf sich nicht ändern");
+
+// Optionales Merkmal-Byte nach den 5 Bytes; ältere Sender lesen es nicht
+#define ESP_NOW_CAPS_FEATURE_FEC 0x01
+
+typedef struct __attribute__((packed)) esp_now_caps_ext_t {
+  esp_now_caps_t caps;
+  uint8_t  features;      // ESP_NOW_CAPS_FEATURE_*
+} esp_now_caps_ext_t;
+
+static_assert(sizeof(esp_now_caps_ext_t) == 6, "CAPS-Layout darf sich nicht ändern");
+
+// CAPS kommt unauthentifiziert von beliebigen MACs: Paketgrößen unter den 250 Bytes, die
+// jeder ESP-NOW Empfänger annimmt, oder Version 0 sind ungültig und werden verworfen
+inline const esp_now_caps_t* espNowParseCaps(const uint8_t* data, int len) {
+  if (len < (int)sizeof(esp_now_caps_t)) return nullptr;
+  const esp_now_caps_t* msg = reinterpret_cast<const esp_now_caps_t*>(data);
+  if (msg->magic != ESP_NOW_CTRL_MAGIC || msg->type != ESP_NOW_CTRL_CAPS) return nullptr;
+  if (msg->max_version < ESP_NOW_PROTOCOL_V1 || msg->max_payload < ESP_NOW_MAX_PAYLOAD) return nullptr;
+  return msg;
+}
+
+// Merkmale aus einer CAPS-Nachricht (0 bei älteren Empfängern)
+inline uint8_t espNowCapsFeatures(const uint8_t* data, int len) {
+  return len >= (int)sizeof(esp_now_caps_ext_t) ? data[offsetof(esp_now_caps_ext_t, features)] : 0;
+}
+
+typedef struct __attribute__((packed)) esp_now_heartbeat_t {
+  uint8_t  magic;
+  uint8_t  type;
+  uint16_t vbat_mv;
+  uint8_t  scene_diff;    // mittlere Helligkeitsdifferenz zum letzten gesendeten Bild (0-255)
+} esp_now_heartbeat_t;
+
+static_assert(sizeof(esp_now_heartbeat_t) == 5, "Heartbeat-Layout darf sich nicht ändern");
+
+inline const esp_now_heartbeat_t* espNowParseHeartbeat(const uint8_t* data, int len) {
+  if (len < (int)sizeof(esp_now_heartbeat_t)) return nullptr;
+  const esp_now_heartbeat_t* msg = reinterpret_cast<const esp_now_heartbeat_t*>(data);
+  if (msg->magic != ESP_NOW_CTRL_MAGIC || msg->type != ESP_NOW_CTRL_HEARTBEAT) return nullptr;
+  return msg;
+}
+
+#define ESP_NOW_LINK_LOSS_UNKNOWN 0xFF
+
+// Vom Empfänger vor dem ACK eines vollständigen Bildes gesendet
+typedef struct __attribute__((packed)) esp_now_link_t {
+  uint8_t  magic;
+  uint8_t  type;
+  uint32_t image_id;
+  int8_t   rssi_avg;      // mittlere RSSI der Chunks dieses Bildes in dBm (0 = unbekannt)
+  int8_t   rssi_min;
+  uint8_t  loss_pct;      // im ersten Durchlauf verlorene oder beschädigte Chunks in % (auch per FEC ersetzte)
+} esp_now_link_t;
+
+static_assert(sizeof(esp_now_link_t) == 9, "LINK-Layout darf sich nicht ändern");
+
+inline const esp_now_link_t* espNowParseLink(const uint8_t* data, int len) {
+  if (len < (int)sizeof(esp_now_link_t)) return nullptr;
+  const esp_now_link_t* msg = reinterpret_cast<const esp_now_link_t*>(data);
+  if (msg->magic != ESP_NOW_CTRL_MAGIC || msg->type != ESP_NOW_CTRL_LINK) return nullptr;
+  return msg;
+}
+
+typedef struct __attribute__((packed)) esp_now_range_t {
+  uint16_t start;
+  uint16_t count;
+} esp_now_range_t;
+
+// Header: magic (1), type (1), image_id (4), received_chunks (2), range_count (1) = 9 Bytes
+#define ESP_NOW_NACK_HEADER_SIZE 9
+#define ESP_NOW_NACK_MAX_RANGES ((ESP_NOW_MAX_PAYLOAD - ESP_NOW_NACK_HEADER_SIZE) / sizeof(esp_now_range_t))
+
+typedef struct __attribute__((packed)) esp_now_nack_t {
+  uint8_t  magic;
+  uint8_t  type;
+  uint32_t image_id;
+  uint16_t received_chunks;
+  uint8_t  range_count;
+  esp_now_range_t ranges[ESP_NOW_NACK_MAX_RANGES];
+} esp_now_nack_t;
+
+static_assert(offsetof(esp_now_nack_t, image_id) == 2 && offsetof(esp_now_nack_t, received_chunks) == 6 &&
+              offsetof(esp_now_nack_t, range_count) == 8, "NACK-Headerlayout darf sich nicht ändern");
+static_assert(offsetof(esp_now_nack_t, ranges) == ESP_NOW_NACK_HEADER_SIZE, "NACK-Header muss 9 Bytes lang sein");
+static_assert(sizeof(esp_now_nack_t) <= ESP_NOW_MAX_PAYLOAD, "NACK muss in ein ESP-NOW Paket passen");
+
+inline size_t espNowNackSize(const esp_now_nack_t& msg) {
+  return ESP_NOW_NACK_HEADER_SIZE + msg.range_count * sizeof(esp_now_range_t);
+}
+
+// Prüft ein empfangenes Paket auf eine gültige Steuer-Nachricht vom Typ NACK
+inline const esp_now_nack_t* espNowParseNack(const uint8_t* data, int len) {
+  if (len < ESP_NOW_NACK_HEADER_SIZE) return nullptr;
+  const esp_now_nack_t* msg = reinterpret_cast<const esp_now_nack_t*>(data);
+  if (msg->magic != ESP_NOW_CTRL_MAGIC || msg->type != ESP_NOW_CTRL_NACK) return nullptr;
+  if (msg->range_count > ESP_NOW_NACK_MAX_RANGES || (size_t)len < espNowNackSize(*msg)) return nullptr;
+  return msg;
+}
+
+#endif // ECOSNAP_ESPNOW_PROTOCOL_H
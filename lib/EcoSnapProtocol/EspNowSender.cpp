@@ -0,0 +1,200 @@
+#include "EspNowSender.h"
+#include <string.h>
+
+EspNowSender::EspNowSender(const Config& config) {
+  setConfig(config);
+}
+
+void EspNowSender::setConfig(const Config& config) {
+  _config = config;
+  if (_config.window == 0) _config.window = 1;
+  if (_config.window > ESP_NOW_MAX_WINDOW) _config.window = ESP_NOW_MAX_WINDOW;
+}
+
+bool EspNowSender::onReceive(const uint8_t* data, int len) {
+  const esp_now_nack_t* msg = espNowParseNack(data, len);
+  if (msg == nullptr) return false;
+  portENTER_CRITICAL(&_ctrlMux);
+  memcpy(&_ctrlMsg, msg, espNowNackSize(*msg));
+  _ctrlPending = true;
+  portEXIT_CRITICAL(&_ctrlMux);
+  wake();
+  return true;
+}
+
+// Blockiert bis zum nächsten Callback (Notification) oder Timeout. Notifications
+// zählen, ein Callback zwischen Prüfung und Warten geht daher nicht verloren;
+// eine übrig gebliebene führt nur zu einem zusätzlichen Schleifendurchlauf.
+void EspNowSender::waitEvent(uint32_t timeoutMs) {
+  TickType_t ticks = pdMS_TO_TICKS(timeoutMs);
+  ulTaskNotifyTake(pdTRUE, ticks > 0 ? ticks : 1);
+}
+
+bool EspNowSender::waitTxDone(uint32_t n, uint32_t timeoutMs) {
+  _waiter = xTaskGetCurrentTaskHandle();
+  unsigned long t0 = millis();
+  while ((int32_t)(_txDone - n) <= 0) {
+    unsigned long elapsed = millis() - t0;
+    if (elapsed >= timeoutMs) break;
+    waitEvent(timeoutMs - elapsed);
+  }
+  _waiter = nullptr;
+  return (int32_t)(_txDone - n) > 0;
+}
+
+// Ein verlorenes Paket einer FEC-Gruppe muss nicht wiederholt werden, solange
+// die Gruppe insgesamt nicht mehr Verluste hat als sie Paritäten trägt. Ein
+// verlorenes MAC-ACK zählt dabei wie ein Verlust (konservativ).
+bool EspNowSender::fecCovers(const EspNowTxImage& img, uint16_t seq) {
+  if (img.fec_m == 0 || !_fecCover) return false;
+  uint16_t group = espNowTxGroupOf(img, seq);
+  if (_groupLost[group] >= img.fec_m) return false;
+  ++_groupLost[group];
+  return true;
+}
+
+// Sendet alle Chunks, die in _acked noch nicht gesetzt sind, mit bis zu
+// window Chunks gleichzeitig "in flight". Jeder Chunk wird per MAC-ACK
+// (onSent) bestätigt; fehlgeschlagene Chunks werden gezielt wiederholt.
+// ACKED bedeutet hier: alle Chunks der Runde per MAC-ACK bestätigt.
+EspNowSender::Result EspNowSender::transmitChunks(const uint8_t* mac, const EspNowTxImage& img, Stats& stats) {
+  uint16_t totalChunks = _acked.total();
+  _inFlight.reset(totalChunks);
+
+  uint16_t flightIdx[ESP_NOW_MAX_WINDOW]; // Chunk-Indizes in Sendereihenfolge
+  uint32_t sentAt[ESP_NOW_MAX_WINDOW];    // micros() beim Senden, für die ACK-Latenz
+  uint32_t roundSent = 0;                 // esp_now_send() Aufrufe in dieser Runde
+  uint32_t handled = _txDone;             // bereits ausgewertete Callbacks
+  uint32_t base = handled;                // Callback-Nummer des ersten Sendevorgangs
+  uint16_t cursor = 0;
+  unsigned long lastProgress = millis();
+
+  while (!_acked.complete()) {
+    // 1) Abgeschlossene Sendungen auswerten
+    uint32_t done = _txDone;
+    while (handled != done) {
+      uint16_t idx = flightIdx[(handled - base) % ESP_NOW_MAX_WINDOW];
+      bool ok = _txStatus[handled % ESP_NOW_MAX_WINDOW];
+      uint32_t doneAt = _txTimeUs[handled % ESP_NOW_MAX_WINDOW];
+      uint32_t ackUs = doneAt - sentAt[(handled - base) % ESP_NOW_MAX_WINDOW];
+      _ackSumUs += ackUs;
+      _wakeSumUs += micros() - doneAt;
+      ++_latencyCount;
+      if (ackUs > stats.ackLatencyMaxUs) stats.ackLatencyMaxUs = ackUs;
+      _inFlight.clear(idx);
+      if (ok) {
+        _acked.set(idx);
+      } else if (fecCovers(img, idx)) {
+        _acked.set(idx);
+        ++stats.fecCovered;
+      } else if (++_retries[idx] > _config.maxRetries) {
+        stats.failedChunk = idx;
+        stats.ackedChunks = _acked.count();
+        return CHUNK_FAILED;
+      } else {
+        ++stats.retransmissions;
+        if (idx < cursor) cursor = idx; // Lücke beim nächsten Durchlauf zuerst schließen
+      }
+      ++handled;
+      lastProgress = millis();
+    }
+
+    // 2) Fenster mit ausstehenden Chunks auffüllen
+    while (roundSent - (handled - base) < _config.window) {
+      uint16_t idx = cursor;
+      while (idx < totalChunks && (_acked.test(idx) || _inFlight.test(idx))) ++idx;
+      if (idx >= totalChunks) break; // nichts mehr zu senden, nur noch auf Callbacks warten
+
+      size_t messageSize = espNowBuildChunk(img, idx, _packet);
+      esp_err_t result = esp_now_send(mac, _packet, messageSize);
+      if (result == ESP_ERR_ESPNOW_NO_MEM) {
+        break; // interne Sende-Queue voll, nach dem nächsten Callback erneut versuchen
+      }
+      if (result != ESP_OK) {
+        stats.failedChunk = idx;
+        stats.error = result;
+        return SEND_ERROR;
+      }
+      flightIdx[roundSent % ESP_NOW_MAX_WINDOW] = idx;
+      sentAt[roundSent % ESP_NOW_MAX_WINDOW] = micros();
+      _inFlight.set(idx);
+      ++roundSent;
+      ++stats.sent;
+      cursor = idx + 1;
+      if (_config.txGapMs > 0) delay(_config.txGapMs);
+    }
+
+    unsigned long idle = millis() - lastProgress;
+    if (idle > _config.stallTimeoutMs) {
+      stats.ackedChunks = _acked.count();
+      return STALLED;
+    }
+    if (_txDone == handled && !_acked.complete()) {
+      waitEvent(_config.stallTimeoutMs + 1 - idle); // bis zum nächsten Sende-Callback
+    }
+  }
+  return ACKED;
+}
+
+// Wartet auf NACK/ACK des Empfängers für imageId; false bei Timeout
+bool EspNowSender::waitForNack(uint32_t imageId) {
+  unsigned long t0 = millis();
+  for (;;) {
+    if (_ctrlPending) {
+      portENTER_CRITICAL(&_ctrlMux);
+      memcpy(&_nack, &_ctrlMsg, espNowNackSize(_ctrlMsg));
+      _ctrlPending = false;
+      portEXIT_CRITICAL(&_ctrlMux);
+      if (_nack.image_id == imageId) return true;
+    }
+    unsigned long elapsed = millis() - t0;
+    if (elapsed >= _config.nackTimeoutMs) return false;
+    waitEvent(_config.nackTimeoutMs - elapsed);
+  }
+}
+
+// Überträgt ein Bild per Sliding Window. Danach meldet der Empfänger per NACK
+// die fehlenden Chunk-Bereiche, die gezielt nachgesendet werden (max.
+// maxNackRounds Runden). Ein NACK ohne Bereiche bestätigt das Bild.
+EspNowSender::Result EspNowSender::send(const uint8_t* mac, const EspNowTxImage& img, Stats& stats) {
+  memset(&stats, 0, sizeof(stats));
+  _acked.reset(img.total_packets);
+  memset(_retries, 0, img.total_packets);
+  memset(_groupLost, 0, sizeof(_groupLost));
+  _ackSumUs = _wakeSumUs = 0;
+  _latencyCount = 0;
+  _waiter = xTaskGetCurrentTaskHandle();
+  Result result = run(mac, img, stats);
+  _waiter = nullptr;
+  if (_latencyCount > 0) {
+    stats.ackLatencyAvgUs = _ackSumUs / _latencyCount;
+    stats.wakeLatencyAvgUs = _wakeSumUs / _latencyCount;
+  }
+  return result;
+}
+
+// Fenster-Runden mit anschließender Auswertung des NACKs
+EspNowSender::Result EspNowSender::run(const uint8_t* mac, const EspNowTxImage& img, Stats& stats) {
+  for (uint8_t round = 0; round <= _config.maxNackRounds; ++round) {
+    _ctrlPending = false;
+    _fecCover = round == 0; // nachgeforderte Chunks konnte die Parität schon nicht ersetzen
+    Result result = transmitChunks(mac, img, stats);
+    if (result != ACKED) return result;
+
+    if (!waitForNack(img.image_id)) return NO_RESPONSE;
+    stats.receivedChunks = _nack.received_chunks;
+    if (_nack.range_count == 0) return ACKED;
+    if (round == _config.maxNackRounds) return INCOMPLETE;
+
+    // Nur die gemeldeten Lücken erneut senden (NACK nennt Chunk-Indizes, keine Paritäten)
+    for (uint16_t i = 0; i < img.total_packets; ++i) _acked.set(i);
+    for (uint8_t r = 0; r < _nack.range_count; ++r) {
+      for (uint16_t i = 0; i < _nack.ranges[r].count; ++i) {
+        _acked.clear(espNowTxDataSeq(img, _nack.ranges[r].start + i));
+        ++stats.retransmissions;
+      }
+    }
+    ++stats.nackRounds;
+  }
+  return INCOMPLETE;
+}
@@ -0,0 +1,117 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – Sendeseite der ESP-NOW Bildübertragung
+//  Sliding Window über die MAC-ACKs des Sende-Callbacks, danach
+//  NACK-Runden mit dem Empfänger. Bei FEC-Bildern werden MAC-Fehler,
+//  die die Paritäten ihrer Gruppe abdecken, im ersten Durchlauf nicht
+//  wiederholt. Funk und Zeit nur über esp_now_send(),
+//  millis()/micros() und FreeRTOS-Task-Notifications, damit derselbe
+//  Ablauf auch in der native-Umgebung (src/native_sim) gegen eine
+//  simulierte Funkstrecke läuft.
+//  Gewartet wird blockierend: die Callbacks wecken den sendenden Task
+//  per Notification, dazwischen ist die CPU im Idle-Task angehalten.
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_ESPNOW_SENDER_H
+#define ECOSNAP_ESPNOW_SENDER_H
+
+#include <Arduino.h>
+#include "EspNowProtocol.h"
+
+// Obergrenze für das Sendefenster (Größe der Status-Ringe, Zweierpotenz)
+#define ESP_NOW_MAX_WINDOW 32
+
+class EspNowSender {
+public:
+  struct Config {
+    uint8_t  window;          // Max. gleichzeitig unbestätigte Chunks (<= ESP_NOW_MAX_WINDOW)
+    uint8_t  maxRetries;      // MAC-Fehlversuche pro Chunk, danach Abbruch
+    uint16_t txGapMs;         // Optionale Pause zwischen Sendungen
+    uint16_t nackTimeoutMs;   // Wartezeit auf NACK/ACK nach einer Runde
+    uint8_t  maxNackRounds;   // Max. Nachsende-Runden aufgrund von NACKs
+    uint16_t stallTimeoutMs;  // Abbruch, wenn so lange kein Chunk bestätigt wird
+  };
+
+  enum Result : uint8_t {
+    ACKED,         // Empfänger hat das vollständige Bild bestätigt
+    NO_RESPONSE,   // Alle MAC-ACKs da, aber kein NACK/ACK (Empfänger ohne NACK-Unterstützung)
+    SEND_ERROR,    // esp_now_send() lieferte einen Fehler (Stats::error)
+    CHUNK_FAILED,  // Ein Chunk wurde nach maxRetries nicht zugestellt (Stats::failedChunk)
+    STALLED,       // Keine Sende-Callbacks mehr innerhalb stallTimeoutMs
+    INCOMPLETE     // Nach maxNackRounds fehlen noch Chunks
+  };
+
+  struct Stats {
+    uint32_t sent;             // esp_now_send() Aufrufe
+    uint32_t retransmissions;  // Wiederholungen nach MAC-Fehler oder NACK
+    uint16_t fecCovered;       // MAC-Fehler ohne Wiederholung, da per FEC ersetzbar
+    uint8_t  nackRounds;       // Runden mit gemeldeten Lücken
+    uint16_t ackedChunks;      // per MAC-ACK bestätigt (bei Abbruch)
+    uint16_t receivedChunks;   // laut letztem NACK des Empfängers
+    uint16_t failedChunk;      // Sendenummer des Pakets (ohne FEC = Chunk-Index)
+    int      error;
+    uint32_t ackLatencyAvgUs;  // esp_now_send() bis Sende-Callback (Funk + Sende-Queue), Mittel
+    uint32_t ackLatencyMaxUs;
+    uint32_t wakeLatencyAvgUs; // Sende-Callback bis zur Auswertung im sendenden Task, Mittel
+  };
+
+  explicit EspNowSender(const Config& config);
+
+  // Neue Parameter ab dem nächsten send() (z.B. kurze Timeouts im Live-Modus)
+  void setConfig(const Config& config);
+  const Config& config() const { return _config; }
+
+  // Aus dem Sende-Callback (WiFi-Task). ESP-NOW liefert die Callbacks in
+  // Sendereihenfolge, daher genügt ein Zähler.
+  void onSent(bool ok) {
+    uint32_t n = _txDone;
+    _txStatus[n % ESP_NOW_MAX_WINDOW] = ok;
+    _txTimeUs[n % ESP_NOW_MAX_WINDOW] = micros();
+    _txDone = n + 1;
+    wake();
+  }
+
+  // Aus dem Empfangs-Callback: übernimmt NACK/ACK; false wenn es keine NACK-Nachricht war
+  bool onReceive(const uint8_t* data, int len);
+
+  // Für einzelne Sendungen außerhalb von send() (z.B. Heartbeat): Callback-Zähler und Status
+  uint32_t txDone() const { return _txDone; }
+  bool txStatus(uint32_t n) const { return _txStatus[n % ESP_NOW_MAX_WINDOW]; }
+  // Wartet blockierend, bis der Callback Nummer n eingetroffen ist; false bei Timeout
+  bool waitTxDone(uint32_t n, uint32_t timeoutMs);
+
+  // Überträgt ein Bild an mac (Peer muss bereits angelegt sein); blockiert bis zum Ergebnis
+  Result send(const uint8_t* mac, const EspNowTxImage& img, Stats& stats);
+
+private:
+  Result run(const uint8_t* mac, const EspNowTxImage& img, Stats& stats);
+  Result transmitChunks(const uint8_t* mac, const EspNowTxImage& img, Stats& stats);
+  bool waitForNack(uint32_t imageId);
+  bool fecCovers(const EspNowTxImage& img, uint16_t seq);
+  void waitEvent(uint32_t timeoutMs);
+  void wake() {
+    TaskHandle_t task = _waiter;
+    if (task != nullptr) xTaskNotifyGive(task);
+  }
+
+  Config _config;
+  volatile uint8_t  _txStatus[ESP_NOW_MAX_WINDOW];
+  volatile uint32_t _txTimeUs[ESP_NOW_MAX_WINDOW]; // micros() im Sende-Callback
+  volatile uint32_t _txDone = 0;
+  TaskHandle_t volatile _waiter = nullptr; // wartender Task, wird von den Callbacks geweckt
+
+  esp_now_nack_t _ctrlMsg;          // Letzte Steuer-Nachricht vom Empfänger
+  volatile bool  _ctrlPending = false;
+  portMUX_TYPE   _ctrlMux = portMUX_INITIALIZER_UNLOCKED;
+
+  esp_now_nack_t _nack;
+  ChunkBitmap _acked;               // in dieser Runde nicht (mehr) zu sendende Pakete (Sendenummer)
+  ChunkBitmap _inFlight;            // gesendet, Callback steht noch aus
+  uint64_t _ackSumUs = 0;           // Summen für die Mittelwerte in Stats
+  uint64_t _wakeSumUs = 0;
+  uint32_t _latencyCount = 0;
+  uint8_t _retries[ESP_NOW_MAX_CHUNKS]; // MAC-Fehlversuche pro Paket (pro Bild)
+  uint8_t _groupLost[ESP_NOW_MAX_CHUNKS / 2]; // per FEC abgedeckte Verluste je Gruppe (>= 2 Pakete)
+  bool _fecCover = false;
+  uint8_t _packet[ESP_NOW_MAX_PAYLOAD_LARGE]; // Header + Daten des aktuellen Chunks
+};
+
+#endif // ECOSNAP_ESPNOW_SENDER_H
@@ -0,0 +1,85 @@
+#include "Fec.h"
+#include <string.h>
+
+// GF(256) mit dem Polynom x^8 + x^4 + x^3 + x^2 + 1 (0x11D), Erzeuger 2
+static uint8_t gfExp[512];
+static uint8_t gfLog[256];
+
+static void gfInit() {
+  if (gfExp[0] != 0) return;
+  uint16_t x = 1;
+  for (uint16_t i = 0; i < 255; ++i) {
+    gfExp[i] = x;
+    gfLog[x] = i;
+    x <<= 1;
+    if (x & 0x100) x ^= 0x11D;
+  }
+  for (uint16_t i = 255; i < 512; ++i) gfExp[i] = gfExp[i - 255]; // spart das mod 255
+}
+
+uint8_t fecMul(uint8_t a, uint8_t b) {
+  gfInit();
+  if (a == 0 || b == 0) return 0;
+  return gfExp[gfLog[a] + gfLog[b]];
+}
+
+static uint8_t gfInv(uint8_t a) {
+  return gfExp[255 - gfLog[a]];
+}
+
+// Cauchy-Element 1 / (x_row + y_col) mit x_row = row, y_col = ESP_NOW_FEC_MAX_M + col
+// (alle verschieden), geteilt durch das Element der Zeile 0 derselben Spalte
+uint8_t fecCoef(uint8_t row, uint8_t col) {
+  gfInit();
+  uint8_t y = ESP_NOW_FEC_MAX_M + col;
+  uint8_t c = gfInv(row ^ y);
+  return fecMul(c, y); // c / (1 / (0 ^ y)) = c * y
+}
+
+void fecMulAdd(uint8_t* dst, const uint8_t* src, uint8_t coef, size_t len) {
+  if (coef == 0) return;
+  if (coef == 1) {
+    for (size_t i = 0; i < len; ++i) dst[i] ^= src[i];
+    return;
+  }
+  gfInit();
+  uint8_t row[256];
+  uint8_t logC = gfLog[coef];
+  row[0] = 0;
+  for (uint16_t x = 1; x < 256; ++x) row[x] = gfExp[gfLog[x] + logC];
+  for (size_t i = 0; i < len; ++i) dst[i] ^= row[src[i]];
+}
+
+// Gauß-Jordan mit angehängter Einheitsmatrix (n <= ESP_NOW_FEC_MAX_M)
+bool fecInvert(uint8_t* m, uint8_t n) {
+  if (n == 0 || n > ESP_NOW_FEC_MAX_M) return false;
+  uint8_t inv[ESP_NOW_FEC_MAX_M * ESP_NOW_FEC_MAX_M] = {};
+  for (uint8_t i = 0; i < n; ++i) inv[i * n + i] = 1;
+
+  for (uint8_t col = 0; col < n; ++col) {
+    uint8_t pivot = col;
+    while (pivot < n && m[pivot * n + col] == 0) ++pivot;
+    if (pivot == n) return false;
+    if (pivot != col) {
+      for (uint8_t k = 0; k < n; ++k) {
+        uint8_t t = m[col * n + k]; m[col * n + k] = m[pivot * n + k]; m[pivot * n + k] = t;
+        t = inv[col * n + k]; inv[col * n + k] = inv[pivot * n + k]; inv[pivot * n + k] = t;
+      }
+    }
+    uint8_t scale = gfInv(m[col * n + col]);
+    for (uint8_t k = 0; k < n; ++k) {
+      m[col * n + k] = fecMul(m[col * n + k], scale);
+      inv[col * n + k] = fecMul(inv[col * n + k], scale);
+    }
+    for (uint8_t r = 0; r < n; ++r) {
+      uint8_t f = m[r * n + col];
+      if (r == col || f == 0) continue;
+      for (uint8_t k = 0; k < n; ++k) {
+        m[r * n + k] ^= fecMul(f, m[col * n + k]);
+        inv[r * n + k] ^= fecMul(f, inv[col * n + k]);
+      }
+    }
+  }
+  memcpy(m, inv, n * n);
+  return true;
+}
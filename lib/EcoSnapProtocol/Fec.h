@@ -0,0 +1,34 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – Vorwärtsfehlerkorrektur über Chunk-Gruppen
+//  Systematischer Erasure-Code über GF(256): je Gruppe aus K Daten-
+//  Chunks werden M Paritäts-Chunks gesendet, aus denen der Empfänger
+//  bis zu M fehlende Chunks der Gruppe ohne Rückfrage wiederherstellt.
+//  Die Koeffizienten stammen aus einer Cauchy-Matrix, spaltenweise so
+//  normiert, dass Parität 0 ein reines XOR ist. Jede quadratische
+//  Teilmatrix bleibt dabei invertierbar, d.h. jede Auswahl von bis zu M
+//  fehlenden Chunks ist lösbar (Reed-Solomon-Eigenschaft).
+//  Multiplikation über log/exp-Tabellen; fecMulAdd() baut je Aufruf
+//  eine 256-Byte-Zeile für den Koeffizienten und arbeitet dann nur
+//  noch mit einem Tabellenzugriff pro Byte.
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_FEC_H
+#define ECOSNAP_FEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ESP_NOW_FEC_MAX_K 32   // Daten-Chunks je Gruppe
+#define ESP_NOW_FEC_MAX_M 4    // Paritäts-Chunks je Gruppe
+
+uint8_t fecMul(uint8_t a, uint8_t b);
+
+// Koeffizient von Daten-Chunk col (0..K-1) in Parität row (0..M-1); row 0 ist immer 1
+uint8_t fecCoef(uint8_t row, uint8_t col);
+
+// dst ^= coef * src über len Bytes
+void fecMulAdd(uint8_t* dst, const uint8_t* src, uint8_t coef, size_t len);
+
+// Invertiert die n x n Matrix m (zeilenweise) in place; false wenn singulär
+bool fecInvert(uint8_t* m, uint8_t n);
+
+#endif // ECOSNAP_FEC_H
@@ -0,0 +1,204 @@
+#include "ImageAssembly.h"
+#include "Fec.h"
+#include <string.h>
+
+bool ImageAssembly::begin(uint32_t imageId, uint32_t totalSize, uint16_t totalChunks, uint16_t chunkSize,
+                          uint8_t* buffer, uint32_t capacity) {
+  reset();
+  if (buffer == nullptr || totalSize == 0 || totalSize > capacity || chunkSize == 0) return false;
+  if (totalChunks == 0 || totalChunks > ESP_NOW_MAX_CHUNKS) return false;
+  // Chunk-Anzahl muss zur Bildgröße passen
+  if ((totalSize + chunkSize - 1) / chunkSize != totalChunks) return false;
+
+  _buffer = buffer;
+  _chunkSize = chunkSize;
+  _imageId = imageId;
+  _totalSize = totalSize;
+  _received.reset(totalChunks);
+  uint32_t slots = _parityStore != nullptr ? _parityStoreSize / chunkSize : 0;
+  _paritySlotCount = slots > MAX_PARITY_SLOTS ? MAX_PARITY_SLOTS : slots;
+  return true;
+}
+
+void ImageAssembly::setParityStore(uint8_t* buffer, uint32_t size) {
+  _parityStore = buffer;
+  _parityStoreSize = buffer != nullptr ? size : 0;
+}
+
+void ImageAssembly::reset() {
+  _buffer = nullptr;
+  _imageId = 0;
+  _totalSize = 0;
+  _receivedBytes = 0;
+  _chunkSize = 0;
+  _imageCrc = 0;
+  _hasImageCrc = false;
+  _received.reset(0);
+  _fecK = _fecM = 0;
+  _recovered = 0;
+  _paritySlotCount = 0;
+  memset(_parity, 0, sizeof(_parity));
+}
+
+void ImageAssembly::restart() {
+  _received.reset(_received.total());
+  _receivedBytes = 0;
+  _recovered = 0;
+  memset(_parity, 0, sizeof(_parity));
+}
+
+ImageAssembly::Result ImageAssembly::add(const EspNowChunk& chunk) {
+  // Vor jeder Zustandsänderung: bei falscher CRC ist auch der Header (z.B. FEC K/M) unzuverlässig
+  if (!chunk.crc_ok) return CHUNK_CORRUPT;
+  if (!active() || chunk.image_id != _imageId || chunk.total_size != _totalSize ||
+      chunk.total_chunks != _received.total() || chunk.chunk_size != _chunkSize) {
+    return CHUNK_INVALID;
+  }
+  if (chunk.fec_k != 0) {
+    if (_fecK == 0) {
+      _fecK = chunk.fec_k;
+      _fecM = chunk.fec_m;
+    } else if (chunk.fec_k != _fecK || chunk.fec_m != _fecM) {
+      return CHUNK_INVALID;
+    }
+  }
+  if (chunk.fec_parity != ESP_NOW_FEC_DATA) return addParity(chunk);
+
+  uint32_t offset = (uint32_t)chunk.chunk_index * _chunkSize;
+  uint32_t expected = _totalSize - offset;
+  if (expected > _chunkSize) expected = _chunkSize;
+  if (offset >= _totalSize || chunk.data_len != expected) return CHUNK_INVALID;
+
+  if (_received.test(chunk.chunk_index)) return CHUNK_DUPLICATE;
+  if (chunk.flags & ESP_NOW_FLAG_IMAGE_CRC) {
+    _imageCrc = chunk.image_crc;
+    _hasImageCrc = true;
+  }
+
+  memcpy(_buffer + offset, chunk.data, chunk.data_len);
+  _received.set(chunk.chunk_index);
+  _receivedBytes += chunk.data_len;
+  if (_fecK != 0) recover(chunk.chunk_index / _fecK); // Parität kann vor dem Rest der Gruppe eintreffen
+  return CHUNK_NEW;
+}
+
+// ───────── FEC ─────────
+
+uint8_t ImageAssembly::dataInGroup(uint16_t group) const {
+  uint16_t rest = _received.total() - group * _fecK;
+  return rest < _fecK ? rest : _fecK;
+}
+
+uint32_t ImageAssembly::chunkLen(uint16_t idx) const {
+  uint32_t n = _totalSize - (uint32_t)idx * _chunkSize;
+  return n < _chunkSize ? n : _chunkSize;
+}
+
+void ImageAssembly::dropParity(uint16_t group) {
+  for (uint8_t s = 0; s < _paritySlotCount; ++s) {
+    if (_parity[s].group == group) _parity[s].used = false;
+  }
+}
+
+ImageAssembly::Result ImageAssembly::addParity(const EspNowChunk& chunk) {
+  uint16_t group = chunk.chunk_index / _fecK;
+  uint16_t first = group * _fecK;
+  uint8_t missing = 0;
+  for (uint8_t i = 0; i < dataInGroup(group); ++i) {
+    if (!_received.test(first + i)) ++missing;
+  }
+  if (missing == 0) return CHUNK_DUPLICATE; // Gruppe vollständig, Parität wird nicht gebraucht
+
+  uint8_t slot = MAX_PARITY_SLOTS;
+  for (uint8_t s = 0; s < _paritySlotCount; ++s) {
+    if (_parity[s].used && _parity[s].group == group && _parity[s].parity == chunk.fec_parity) return CHUNK_DUPLICATE;
+    if (!_parity[s].used && slot == MAX_PARITY_SLOTS) slot = s;
+  }
+  if (slot == MAX_PARITY_SLOTS) {
+    // Speicher voll: Parität der ältesten Gruppe verdrängen; gesendet wird
+    // gruppenweise aufsteigend, ältere Gruppen bekommen kaum noch Nachschub
+    for (uint8_t s = 0; s < _paritySlotCount; ++s) {
+      if (_parity[s].group < group && (slot == MAX_PARITY_SLOTS || _parity[s].group < _parity[slot].group)) slot = s;
+    }
+    if (slot == MAX_PARITY_SLOTS) return CHUNK_PARITY; // ohne Platz verworfen
+  }
+
+  memcpy(_parityStore + (uint32_t)slot * _chunkSize, chunk.data, _chunkSize);
+  _parity[slot] = { group, chunk.fec_parity, true };
+  recover(group);
+  return CHUNK_PARITY;
+}
+
+// Stellt die fehlenden Chunks einer Gruppe wieder her, sobald so viele Paritäten
+// wie Lücken vorliegen: Syndrome s_a = p_a + Summe coef * vorhandene Chunks,
+// dann fehlende Chunks = A^-1 * s mit A = Koeffizienten der Lücken.
+void ImageAssembly::recover(uint16_t group) {
+  uint16_t first = group * _fecK;
+  uint8_t count = dataInGroup(group);
+  uint16_t missing[ESP_NOW_FEC_MAX_M];
+  uint8_t e = 0;
+  for (uint8_t i = 0; i < count; ++i) {
+    if (_received.test(first + i)) continue;
+    if (e == _fecM) return; // mehr Lücken als Paritäten möglich
+    missing[e++] = first + i;
+  }
+  if (e == 0) {
+    dropParity(group);
+    return;
+  }
+
+  uint8_t rows[ESP_NOW_FEC_MAX_M];
+  uint8_t r = 0;
+  for (uint8_t s = 0; s < _paritySlotCount && r < e; ++s) {
+    if (_parity[s].used && _parity[s].group == group) rows[r++] = s;
+  }
+  if (r < e) return;
+
+  uint8_t m[ESP_NOW_FEC_MAX_M * ESP_NOW_FEC_MAX_M];
+  for (uint8_t a = 0; a < e; ++a) {
+    uint8_t* syn = _parityStore + (uint32_t)rows[a] * _chunkSize;
+    uint8_t j = _parity[rows[a]].parity;
+    for (uint8_t i = 0; i < count; ++i) {
+      uint16_t idx = first + i;
+      if (_received.test(idx)) fecMulAdd(syn, _buffer + (uint32_t)idx * _chunkSize, fecCoef(j, i), chunkLen(idx));
+    }
+    for (uint8_t b = 0; b < e; ++b) m[a * e + b] = fecCoef(j, missing[b] - first);
+  }
+  if (fecInvert(m, e)) {
+    for (uint8_t b = 0; b < e; ++b) {
+      uint8_t* dst = _buffer + (uint32_t)missing[b] * _chunkSize;
+      uint32_t len = chunkLen(missing[b]);
+      memset(dst, 0, len);
+      for (uint8_t a = 0; a < e; ++a) {
+        fecMulAdd(dst, _parityStore + (uint32_t)rows[a] * _chunkSize, m[b * e + a], len);
+      }
+      _received.set(missing[b]);
+      _receivedBytes += len;
+    }
+    _recovered += e;
+  }
+  dropParity(group);
+}
+
+bool ImageAssembly::verify() const {
+  return !_hasImageCrc || espNowCrc32(0, _buffer, _totalSize) == _imageCrc;
+}
+
+size_t ImageAssembly::buildNack(esp_now_nack_t& msg) const {
+  msg.magic = ESP_NOW_CTRL_MAGIC;
+  msg.type = ESP_NOW_CTRL_NACK;
+  msg.image_id = _imageId;
+  msg.received_chunks = _received.count();
+  msg.range_count = 0;
+
+  uint16_t total = _received.total();
+  uint16_t idx = _received.nextClear(0);
+  while (idx < total && msg.range_count < ESP_NOW_NACK_MAX_RANGES) {
+    uint16_t end = _received.nextSet(idx);
+    msg.ranges[msg.range_count].start = idx;
+    msg.ranges[msg.range_count].count = end - idx;
+    ++msg.range_count;
+    idx = _received.nextClear(end);
+  }
+  return espNowNackSize(msg);
+}
@@ -0,0 +1,88 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – Zusammensetzen eines Bildes aus ESP-NOW Chunks
+//  Reihenfolge-unabhängig, Duplikate werden ignoriert, fehlende
+//  Chunks lassen sich als NACK-Bereiche abfragen. Bei FEC-Bildern
+//  werden Paritäts-Chunks zwischengespeichert und fehlende Chunks
+//  einer Gruppe daraus wiederhergestellt (siehe Fec.h).
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_IMAGE_ASSEMBLY_H
+#define ECOSNAP_IMAGE_ASSEMBLY_H
+
+#include "EspNowProtocol.h"
+
+class ImageAssembly {
+public:
+  enum Result : uint8_t {
+    CHUNK_NEW,        // Chunk übernommen
+    CHUNK_DUPLICATE,  // Chunk war bereits vorhanden
+    CHUNK_INVALID,    // Passt nicht zum Bild (ID, Größe, Offset)
+    CHUNK_CORRUPT,    // Chunk-CRC falsch; ändert keinen Zustand, bleibt fehlend und wird per NACK neu angefordert
+    CHUNK_PARITY,     // Paritäts-Chunk übernommen oder verbraucht (ggf. Chunks wiederhergestellt)
+  };
+
+  // Max. gleichzeitig zwischengespeicherte Paritäts-Chunks
+  static constexpr uint8_t MAX_PARITY_SLOTS = 8;
+
+  // Startet ein neues Bild im übergebenen Puffer (mind. totalSize Bytes)
+  bool begin(uint32_t imageId, uint32_t totalSize, uint16_t totalChunks, uint16_t chunkSize,
+             uint8_t* buffer, uint32_t capacity);
+  void reset();
+  // Speicher für Paritäts-Chunks (ohne: FEC-Paritäten werden verworfen); gilt ab dem nächsten begin()
+  void setParityStore(uint8_t* buffer, uint32_t size);
+  // Verwirft alle empfangenen Chunks des laufenden Bildes (z.B. nach falscher Bild-CRC)
+  void restart();
+
+  Result add(const EspNowChunk& chunk);
+
+  // Füllt msg mit den fehlenden Bereichen (max. ESP_NOW_NACK_MAX_RANGES);
+  // liefert die Nachrichtengröße in Bytes.
+  size_t buildNack(esp_now_nack_t& msg) const;
+
+  // Prüft das vollständige Bild gegen die Bild-CRC aus Chunk 0; true ohne CRC
+  bool verify() const;
+  bool hasImageCrc() const { return _hasImageCrc; }
+
+  bool active() const { return _buffer != nullptr; }
+  bool complete() const { return active() && _received.complete(); }
+  uint32_t imageId() const { return _imageId; }
+  uint32_t totalSize() const { return _totalSize; }
+  uint16_t totalChunks() const { return _received.total(); }
+  uint16_t chunkSize() const { return _chunkSize; }
+  uint16_t receivedChunks() const { return _received.count(); }
+  uint32_t receivedBytes() const { return _receivedBytes; }
+  uint8_t* buffer() const { return _buffer; }
+  bool hasChunk(uint16_t idx) const { return _received.test(idx); }
+  uint16_t recoveredChunks() const { return _recovered; }
+
+private:
+  struct ParitySlot {
+    uint16_t group;
+    uint8_t  parity;
+    bool     used;
+  };
+
+  Result addParity(const EspNowChunk& chunk);
+  uint8_t dataInGroup(uint16_t group) const;
+  uint32_t chunkLen(uint16_t idx) const;
+  void dropParity(uint16_t group);
+  void recover(uint16_t group);
+
+  ChunkBitmap _received;
+  uint8_t* _buffer = nullptr;
+  uint32_t _imageId = 0;
+  uint32_t _totalSize = 0;
+  uint32_t _receivedBytes = 0;
+  uint16_t _chunkSize = 0;
+  uint32_t _imageCrc = 0;
+  bool _hasImageCrc = false;
+  // FEC (K und M aus dem ersten FEC-Paket des Bildes)
+  uint8_t _fecK = 0;
+  uint8_t _fecM = 0;
+  uint16_t _recovered = 0;
+  uint8_t* _parityStore = nullptr;
+  uint32_t _parityStoreSize = 0;
+  uint8_t _paritySlotCount = 0;
+  ParitySlot _parity[MAX_PARITY_SLOTS] = {};
+};
+
+#endif // ECOSNAP_IMAGE_ASSEMBLY_H
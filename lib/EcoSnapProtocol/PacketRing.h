@@ -0,0 +1,72 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – Lock-freier Single-Producer/Single-Consumer Ringpuffer
+//  für empfangene ESP-NOW Pakete. Producer ist der WiFi-Callback,
+//  Consumer der Verarbeitungs-Task. Alle Slots werden statisch belegt.
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_PACKET_RING_H
+#define ECOSNAP_PACKET_RING_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+template <uint16_t SLOTS, uint16_t MAX_LEN>
+class PacketRing {
+  static_assert(SLOTS >= 2 && (SLOTS & (SLOTS - 1)) == 0, "SLOTS muss eine Zweierpotenz sein");
+
+public:
+  struct Packet {
+    uint8_t  mac[6];
+    int8_t   rssi;     // dBm, 0 = unbekannt
+    uint16_t len;
+    uint8_t  data[MAX_LEN];
+  };
+
+  // Producer: kopiert das Paket in den nächsten freien Slot; false wenn voll
+  bool push(const uint8_t* mac, const uint8_t* data, int len, int8_t rssi = 0) {
+    if (len <= 0 || len > MAX_LEN) {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t used = head - _tail.load(std::memory_order_acquire);
+    if (used >= SLOTS) {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    Packet& p = _slots[head & (SLOTS - 1)];
+    memcpy(p.mac, mac, 6);
+    p.rssi = rssi;
+    p.len = len;
+    memcpy(p.data, data, len);
+    _head.store(head + 1, std::memory_order_release);
+    if (used + 1 > _highWater.load(std::memory_order_relaxed)) {
+      _highWater.store(used + 1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Consumer: ältestes Paket oder nullptr; nach Verarbeitung pop() aufrufen
+  const Packet* front() const {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire)) return nullptr;
+    return &_slots[tail & (SLOTS - 1)];
+  }
+
+  void pop() {
+    _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  uint16_t capacity() const { return SLOTS; }
+  uint16_t highWater() const { return _highWater.load(std::memory_order_relaxed); }
+  uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+  Packet _slots[SLOTS];
+  std::atomic<uint32_t> _head{0};
+  std::atomic<uint32_t> _tail{0};
+  std::atomic<uint16_t> _highWater{0};
+  std::atomic<uint32_t> _dropped{0};
+};
+
+#endif // ECOSNAP_PACKET_RING_H
@@ -0,0 +1,65 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – Wachzeit-Profil des Senders
+//  Dauer der einzelnen Phasen eines Weckzyklus in ms. Der Sender führt
+//  einen Verlauf im RTC-Speicher und hängt das Profil des letzten
+//  vollständigen Zyklus an den Upload (HTTP-Parameter bzw. Header-
+//  Erweiterung ESP_NOW_FLAG_WAKE_PROFILE in Chunk 0).
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_WAKE_PROFILE_H
+#define ECOSNAP_WAKE_PROFILE_H
+
+#include "EspNowProtocol.h"
+#include <string.h>
+
+enum WakePhase : uint8_t {
+  WAKE_BOOT,     // Reset bis Beginn setup()-Arbeit
+  WAKE_VBAT,     // Batteriemessung
+  WAKE_CAMERA,   // Kamera-Initialisierung
+  WAKE_CAPTURE,  // Belichtung einschwingen, Aufnahme(n), Änderungserkennung
+  WAKE_LINK,     // Warten auf WiFi bzw. ESP-NOW Initialisierung
+  WAKE_UPLOAD,   // Upload inkl. Nachsenden aus dem Zwischenspeicher
+  WAKE_SLEEP,    // Abschalten bis esp_deep_sleep_start()
+  WAKE_PHASE_COUNT
+};
+
+static const char* const WAKE_PHASE_NAMES[WAKE_PHASE_COUNT] = {
+  "boot", "vbat", "cam", "capture", "link", "upload", "sleep"
+};
+
+struct WakeProfile {
+  uint16_t phase_ms[WAKE_PHASE_COUNT];
+
+  uint32_t totalMs() const {
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < WAKE_PHASE_COUNT; ++i) sum += phase_ms[i];
+    return sum;
+  }
+};
+
+// Erweiterungsformat: Anzahl Phasen (1), danach je Phase uint16 ms (Little Endian)
+#define WAKE_PROFILE_EXT_SIZE (1 + 2 * WAKE_PHASE_COUNT)
+static_assert(WAKE_PROFILE_EXT_SIZE <= ESP_NOW_MAX_HEADER_EXT, "Profil muss in die Header-Erweiterung passen");
+
+inline uint8_t wakeProfilePack(const WakeProfile& p, uint8_t* out) {
+  out[0] = WAKE_PHASE_COUNT;
+  for (uint8_t i = 0; i < WAKE_PHASE_COUNT; ++i) {
+    out[1 + 2 * i] = p.phase_ms[i] & 0xFF;
+    out[2 + 2 * i] = p.phase_ms[i] >> 8;
+  }
+  return WAKE_PROFILE_EXT_SIZE;
+}
+
+// Liest das Profil aus den Header-Erweiterungen eines Chunks; false wenn keines enthalten ist.
+// Sender mit mehr Phasen als bekannt: überzählige werden ignoriert.
+inline bool wakeProfileFromChunk(const EspNowChunk& chunk, WakeProfile& out) {
+  const uint8_t* ext = espNowFindExt(chunk, ESP_NOW_FLAG_WAKE_PROFILE);
+  if (ext == nullptr) return false;
+  uint8_t count = ext[0];
+  memset(&out, 0, sizeof(out));
+  for (uint8_t i = 0; i < count && i < WAKE_PHASE_COUNT; ++i) {
+    out.phase_ms[i] = ext[1 + 2 * i] | (ext[2 + 2 * i] << 8);
+  }
+  return true;
+}
+
+#endif // ECOSNAP_WAKE_PROFILE_H
@@ -0,0 +1,110 @@
+#include "SimCamera.h"
+#include <dirent.h>
+#include <algorithm>
+#include <ctype.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Fixture {
+  std::string name;
+  std::vector<uint8_t> data;
+  camera_fb_t fb;
+};
+
+std::vector<Fixture> fixtures;
+size_t nextFixture = 0;
+bool synthetic = false;
+
+bool hasJpegExtension(const std::string& name) {
+  size_t dot = name.rfind('.');
+  if (dot == std::string::npos) return false;
+  std::string ext = name.substr(dot + 1);
+  for (char& c : ext) c = tolower(c);
+  return ext == "jpg" || ext == "jpeg";
+}
+
+bool readFile(const std::string& path, std::vector<uint8_t>& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == nullptr) return false;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  out.resize(size > 0 ? size : 0);
+  bool ok = size > 0 && fread(out.data(), 1, size, f) == (size_t)size;
+  fclose(f);
+  return ok;
+}
+
+// SOI + Pseudozufallsdaten + EOI; für das Protokoll zählt nur die Größe
+void addSynthetic(const char* name, size_t len, uint32_t seed) {
+  Fixture fx;
+  fx.name = name;
+  fx.data.resize(len);
+  for (size_t i = 0; i < len; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    fx.data[i] = seed >> 24;
+  }
+  fx.data[0] = 0xFF; fx.data[1] = 0xD8;
+  fx.data[len - 2] = 0xFF; fx.data[len - 1] = 0xD9;
+  fixtures.push_back(std::move(fx));
+}
+
+} // namespace
+
+size_t simCameraLoad(const char* dir) {
+  fixtures.clear();
+  nextFixture = 0;
+  synthetic = false;
+  if (DIR* d = opendir(dir)) {
+    while (dirent* entry = readdir(d)) {
+      std::string name = entry->d_name;
+      if (!hasJpegExtension(name)) continue;
+      Fixture fx;
+      fx.name = name;
+      if (!readFile(std::string(dir) + "/" + name, fx.data)) continue;
+      if (fx.data.size() < 4 || fx.data[0] != 0xFF || fx.data[1] != 0xD8) {
+        printf("[Kamera] %s ist kein JPEG, uebersprungen\n", name.c_str());
+        continue;
+      }
+      fixtures.push_back(std::move(fx));
+    }
+    closedir(d);
+    std::sort(fixtures.begin(), fixtures.end(),
+              [](const Fixture& a, const Fixture& b) { return a.name < b.name; });
+  }
+  if (fixtures.empty()) {
+    synthetic = true;
+    addSynthetic("synthetisch_QVGA_12k", 12 * 1024, 1);
+    addSynthetic("synthetisch_SVGA_45k", 45 * 1024, 2);
+    addSynthetic("synthetisch_UXGA_110k", 110 * 1024, 3);
+  }
+  for (Fixture& fx : fixtures) {
+    fx.fb = camera_fb_t{ fx.data.data(), fx.data.size(), 0, 0, PIXFORMAT_JPEG };
+  }
+  return fixtures.size();
+}
+
+const char* simCameraName(const camera_fb_t* fb) {
+  for (const Fixture& fx : fixtures) {
+    if (&fx.fb == fb) return fx.name.c_str();
+  }
+  return "?";
+}
+
+bool simCameraSynthetic() {
+  return synthetic;
+}
+
+// ───────── Shims: Kamera ─────────
+camera_fb_t* esp_camera_fb_get() {
+  if (fixtures.empty()) return nullptr;
+  Fixture& fx = fixtures[nextFixture];
+  nextFixture = (nextFixture + 1) % fixtures.size();
+  return &fx.fb;
+}
+
+void esp_camera_fb_return(camera_fb_t*) {
+}
@@ -0,0 +1,15 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – JPEG-Fixtures für den Kamera-Ersatz (native-Umgebung)
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_SIM_CAMERA_H
+#define ECOSNAP_SIM_CAMERA_H
+
+#include <esp_camera.h>
+
+// Lädt alle *.jpg/*.jpeg aus dir; ohne Fixtures werden JPEG-ähnliche Puffer
+// in typischen ESP32-CAM Größen erzeugt. Liefert die Anzahl Bilder.
+size_t simCameraLoad(const char* dir);
+const char* simCameraName(const camera_fb_t* fb);
+bool simCameraSynthetic();
+
+#endif // ECOSNAP_SIM_CAMERA_H
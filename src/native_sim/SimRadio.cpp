@@ -0,0 +1,229 @@
+#include "SimRadio.h"
+#include <Arduino.h>
+#include <esp_now.h>
+#include <queue>
+#include <random>
+#include <vector>
+
+namespace {
+
+enum EventType : uint8_t {
+  SEND_DONE,   // Sende-Callback beim Sender
+  TO_PEER,     // Paket erreicht die Gegenstelle
+  TO_SENDER    // Antwort der Gegenstelle erreicht den Sender
+};
+
+struct Event {
+  uint64_t at;
+  uint32_t seq;       // gleiche Zeit: in Einplanungsreihenfolge
+  EventType type;
+  bool ok;
+  uint32_t txSeq;
+  std::vector<uint8_t> data;
+};
+
+struct Later {
+  bool operator()(const Event& a, const Event& b) const {
+    return a.at != b.at ? a.at > b.at : a.seq > b.seq;
+  }
+};
+
+const uint8_t peerMac[6] = { 0x24, 0x6F, 0x28, 0x00, 0x00, 0x01 };
+
+SimRadioConfig cfg;
+SimRadioStats stats;
+std::priority_queue<Event, std::vector<Event>, Later> events;
+std::mt19937 rng;
+uint64_t nowUs = 0;
+uint64_t channelFreeUs = 0;
+uint32_t eventSeq = 0;
+uint32_t txSeq = 0;
+uint32_t lastDeliveredSeq = 0;
+uint8_t pendingSends = 0;
+bool burstState = false;
+
+esp_now_send_cb_t sendCb = nullptr;
+esp_now_recv_cb_t recvCb = nullptr;
+SimPeerRecv peerRecv = nullptr;
+SimPeerTick peerTick = nullptr;
+
+float uniform() {
+  return std::uniform_real_distribution<float>(0.0f, 1.0f)(rng);
+}
+
+// Gilbert-Elliott: im schlechten Zustand gehen alle Frames verloren. Die Übergänge
+// sind so gewählt, dass im Mittel lossRate verloren geht, in Bursts von burstLength.
+bool frameLost() {
+  ++stats.frames;
+  if (cfg.lossRate <= 0.0f) return false;
+  if (cfg.lossRate >= 1.0f) {
+    ++stats.lost;
+    return true;
+  }
+  float burst = cfg.burstLength < 1.0f ? 1.0f : cfg.burstLength;
+  float toGood = 1.0f / burst;
+  float toBad = cfg.lossRate * toGood / (1.0f - cfg.lossRate);
+  burstState = burstState ? uniform() >= toGood : uniform() < toBad;
+  if (burstState) ++stats.lost;
+  return burstState;
+}
+
+// Belegt den Kanal für einen Frame; liefert das Ende der Übertragung
+uint64_t occupyChannel(size_t len) {
+  uint64_t start = nowUs > channelFreeUs ? nowUs : channelFreeUs;
+  // Präambel/MAC-Header ~50 Bytes, dazu MAC-ACK und Wartezeiten ~100 µs
+  uint64_t airtime = (uint64_t)(len + 50) * 8 * 1000 / cfg.phyRateKbps + 100;
+  channelFreeUs = start + airtime;
+  return channelFreeUs;
+}
+
+void schedule(uint64_t at, EventType type, bool ok, uint32_t seq, const uint8_t* data, size_t len) {
+  Event ev;
+  ev.at = at;
+  ev.seq = eventSeq++;
+  ev.type = type;
+  ev.ok = ok;
+  ev.txSeq = seq;
+  if (data != nullptr) ev.data.assign(data, data + len);
+  events.push(std::move(ev));
+}
+
+uint32_t notifications = 0; // Task-Notifications des (einzigen) Sender-Tasks
+
+// Stellt alle bis 'until' fälligen Ereignisse zu; mit stopOnNotify nur bis zur
+// ersten Task-Notification (die Zeit steht dann auf diesem Ereignis)
+void processUntil(uint64_t until, bool stopOnNotify = false) {
+  while (!events.empty() && events.top().at <= until) {
+    if (stopOnNotify && notifications > 0) return;
+    Event ev = events.top();
+    events.pop();
+    nowUs = ev.at;
+    switch (ev.type) {
+      case SEND_DONE:
+        --pendingSends;
+        if (sendCb) sendCb(peerMac, ev.ok ? ESP_NOW_SEND_SUCCESS : ESP_NOW_SEND_FAIL);
+        break;
+      case TO_PEER:
+        if (ev.txSeq < lastDeliveredSeq) {
+          ++stats.reordered;
+        } else {
+          lastDeliveredSeq = ev.txSeq;
+        }
+        if (peerRecv) peerRecv(ev.data.data(), ev.data.size());
+        break;
+      case TO_SENDER:
+        if (recvCb) recvCb(peerMac, ev.data.data(), ev.data.size());
+        break;
+    }
+  }
+  if (stopOnNotify && notifications > 0) return;
+  nowUs = until;
+}
+
+} // namespace
+
+void simRadioBegin(const SimRadioConfig& config, SimPeerRecv recv, SimPeerTick tick) {
+  cfg = config;
+  if (cfg.phyRateKbps == 0) cfg.phyRateKbps = 1000;
+  if (cfg.txQueueDepth == 0) cfg.txQueueDepth = 1;
+  stats = SimRadioStats();
+  events = decltype(events)();
+  rng.seed(cfg.seed);
+  nowUs = channelFreeUs = 0;
+  eventSeq = txSeq = lastDeliveredSeq = 0;
+  pendingSends = 0;
+  notifications = 0;
+  burstState = false;
+  peerRecv = recv;
+  peerTick = tick;
+}
+
+void simRadioReply(const uint8_t* data, int len) {
+  uint64_t end = occupyChannel(len);
+  if (!frameLost()) schedule(end, TO_SENDER, true, 0, data, len);
+}
+
+const SimRadioStats& simRadioStats() {
+  return stats;
+}
+
+uint64_t simRadioNowUs() {
+  return nowUs;
+}
+
+// ───────── Shims: Arduino ─────────
+unsigned long millis() {
+  return nowUs / 1000;
+}
+
+unsigned long micros() {
+  return nowUs;
+}
+
+void delay(unsigned long ms) {
+  for (unsigned long i = 0; i < ms; ++i) {
+    processUntil(nowUs + 1000);
+    if (peerTick) peerTick();
+  }
+}
+
+// ───────── Shims: FreeRTOS ─────────
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  static int task;
+  return &task;
+}
+
+void xTaskNotifyGive(TaskHandle_t) {
+  ++notifications;
+}
+
+// Lässt die Zeit bis zur nächsten Notification laufen, höchstens ticks ms;
+// die Gegenstelle bekommt wie bei delay() jede volle ms ihren Tick
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  uint64_t until = nowUs + (uint64_t)ticks * 1000;
+  while (notifications == 0 && nowUs < until) {
+    uint64_t nextMs = (nowUs / 1000 + 1) * 1000;
+    uint64_t step = nextMs < until ? nextMs : until;
+    processUntil(step, true);
+    if (nowUs == nextMs && peerTick) peerTick();
+  }
+  uint32_t n = notifications;
+  if (n > 0) notifications = clearOnExit ? 0 : n - 1;
+  return n;
+}
+
+// ───────── Shims: ESP-NOW ─────────
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) {
+  sendCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+  recvCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_send(const uint8_t*, const uint8_t* data, size_t len) {
+  if (data == nullptr || len == 0 || len > ESP_NOW_MAX_DATA_LEN_V2) return ESP_ERR_ESPNOW_ARG;
+  if (pendingSends >= cfg.txQueueDepth) return ESP_ERR_ESPNOW_NO_MEM;
+  ++pendingSends;
+  uint32_t seq = ++txSeq;
+  uint64_t end = occupyChannel(len);
+  bool delivered = !frameLost();
+  bool acked = delivered && !frameLost(); // MAC-ACK kann ebenfalls verloren gehen
+  if (delivered) {
+    uint64_t jitter = cfg.jitterUs ? rng() % (cfg.jitterUs + 1) : 0;
+    if (cfg.corruptRate > 0.0f && uniform() < cfg.corruptRate) {
+      // Bitfehler, den die MAC-Prüfsumme nicht erkannt hat (z.B. im Puffer des Empfängers)
+      std::vector<uint8_t> frame(data, data + len);
+      frame[rng() % len] ^= 1 << (rng() % 8);
+      ++stats.corrupted;
+      schedule(end + jitter, TO_PEER, true, seq, frame.data(), len);
+    } else {
+      schedule(end + jitter, TO_PEER, true, seq, data, len);
+    }
+  }
+  // Kanal ist seriell belegt, daher kommen die Callbacks in Sendereihenfolge
+  schedule(end, SEND_DONE, acked, seq, nullptr, 0);
+  return ESP_OK;
+}
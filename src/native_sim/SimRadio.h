@@ -0,0 +1,40 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – simulierte ESP-NOW Funkstrecke (native-Umgebung)
+//  Ein gemeinsamer Kanal mit Sendezeit je Paket, Verlusten nach dem
+//  Gilbert-Elliott-Modell (Bursts) in beiden Richtungen und zufälliger
+//  Zusatzlaufzeit beim Empfänger, die Pakete umsortiert. Optional kommen
+//  Datenpakete mit einem gekippten Bit an (trotz MAC-ACK). Sende-Callbacks
+//  kommen wie auf dem Gerät in Sendereihenfolge.
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_SIM_RADIO_H
+#define ECOSNAP_SIM_RADIO_H
+
+#include <stdint.h>
+
+struct SimRadioConfig {
+  float    lossRate;      // Mittlere Verlustrate je Frame (Daten wie MAC-ACK), 0..1
+  float    burstLength;   // Mittlere Länge eines Verlust-Bursts in Frames (1 = unabhängig)
+  uint32_t jitterUs;      // Max. Zusatzlaufzeit beim Empfänger (Umsortierung)
+  float    corruptRate;   // Anteil zugestellter Datenpakete mit einem gekippten Bit, 0..1
+  uint32_t phyRateKbps;   // Datenrate (ESP-NOW Standard: 1 Mbit/s)
+  uint8_t  txQueueDepth;  // Interne Sende-Queue, danach ESP_ERR_ESPNOW_NO_MEM
+  uint32_t seed;
+};
+
+struct SimRadioStats {
+  uint32_t frames;        // gesendete Frames (beide Richtungen)
+  uint32_t lost;          // davon verloren
+  uint32_t reordered;     // beim Empfänger vor einem älteren Frame angekommen
+  uint32_t corrupted;     // mit gekipptem Bit zugestellt
+};
+
+// Gegenstelle des Senders: bekommt zugestellte Pakete, antwortet per simRadioReply()
+typedef void (*SimPeerRecv)(const uint8_t* data, int len);
+typedef void (*SimPeerTick)();   // jede virtuelle ms, für Timeouts der Gegenstelle
+
+void simRadioBegin(const SimRadioConfig& config, SimPeerRecv recv, SimPeerTick tick);
+void simRadioReply(const uint8_t* data, int len);
+const SimRadioStats& simRadioStats();
+uint64_t simRadioNowUs();
+
+#endif // ECOSNAP_SIM_RADIO_H
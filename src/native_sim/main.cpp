@@ -0,0 +1,281 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – Protokoll-Simulation und Benchmark (native-Umgebung)
+//  Sendet die Kamerabilder (JPEG-Fixtures aus data/bench) mit dem
+//  EspNowSender des Senders über SimRadio an einen Empfänger, der wie
+//  receiver_app mit ImageAssembly zusammensetzt und per NACK/ACK antwortet.
+//  Je Szenario: Durchsatz, Sendungen, Wiederholungen, NACK-Runden und
+//  CPU-Zeit des Zusammensetzens, unerkannt beschädigt angezeigte Bilder,
+//  ACK-Latenz je Chunk und Reaktionszeit des Senders auf den Callback,
+//  bei FEC ersetzte Chunks und die CPU-Zeit der Dekodierung je Bild.
+//  Rückgabewert != 0, wenn ein Bild in einem Pflicht-Szenario (mäßiger
+//  Verlust, Bitfehler nur mit CRC) nicht unverändert ankommt.
+//
+//  Aufruf: pio run -e native -t exec
+//          .pio/build/native/program [Fixture-Verzeichnis] [Wiederholungen]
+// ────────────────────────────────────────────────────────────────
+#include <Arduino.h>
+#include <esp_now.h>
+#include <esp_camera.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "EspNowProtocol.h"
+#include "EspNowSender.h"
+#include "ImageAssembly.h"
+#include "SimCamera.h"
+#include "SimRadio.h"
+
+// Wie in sender_app bzw. receiver_app
+#define SIM_WINDOW_SIZE 8
+#define SIM_MAX_RETRIES_PER_CHUNK 5
+#define SIM_NACK_TIMEOUT_MS 300
+#define SIM_MAX_NACK_ROUNDS 4
+#define SIM_NACK_SILENCE_MS 100
+#define SIM_NACK_MAX_ATTEMPTS 5
+#define SIM_RX_BUFFER_SIZE 262144
+#define SIM_FEC_K 8
+#define SIM_FEC_PARITY_SLOTS 4
+
+static const uint8_t receiverMac[6] = { 0x24, 0x6F, 0x28, 0x00, 0x00, 0x01 };
+
+// ───────── Sender (EspNowSender wie in sender_app) ─────────
+static EspNowSender sender({
+  SIM_WINDOW_SIZE, SIM_MAX_RETRIES_PER_CHUNK, 0,
+  SIM_NACK_TIMEOUT_MS, SIM_MAX_NACK_ROUNDS, 3000
+});
+
+static void OnDataSent(const uint8_t*, esp_now_send_status_t status) {
+  sender.onSent(status == ESP_NOW_SEND_SUCCESS);
+}
+
+static void OnDataRecv(const uint8_t*, const uint8_t* data, int len) {
+  sender.onReceive(data, len);
+}
+
+// ───────── Empfänger (Ablauf wie handlePacket/serviceNack in receiver_app) ─────────
+struct SimReceiver {
+  ImageAssembly assembly;
+  std::vector<uint8_t> buffer;
+  std::vector<uint8_t> parity;
+  unsigned long lastActivity;
+  uint8_t nackAttempts;
+  uint64_t cpuNs;       // Parsen + Zusammensetzen
+  uint64_t fecNs;       // davon Paritäten speichern und Chunks wiederherstellen
+  uint32_t packets;
+};
+static SimReceiver rx;
+
+static void rxSendNack() {
+  esp_now_nack_t msg;
+  size_t len = rx.assembly.buildNack(msg);
+  simRadioReply((const uint8_t*)&msg, len);
+}
+
+static void rxReceive(const uint8_t* data, int len) {
+  auto t0 = std::chrono::steady_clock::now();
+  EspNowChunk chunk;
+  bool valid = espNowParseChunk(data, len, chunk);
+  ImageAssembly::Result result = ImageAssembly::CHUNK_INVALID;
+  if (valid && !chunk.crc_ok) {
+    result = ImageAssembly::CHUNK_CORRUPT; // vor jedem begin(): Header unzuverlässig
+  } else if (valid) {
+    if (!rx.assembly.active() || rx.assembly.imageId() != chunk.image_id) {
+      rx.assembly.begin(chunk.image_id, chunk.total_size, chunk.total_chunks, chunk.chunk_size,
+                        rx.buffer.data(), rx.buffer.size());
+      rx.nackAttempts = 0;
+    }
+    uint16_t recovered = rx.assembly.recoveredChunks();
+    auto ta = std::chrono::steady_clock::now();
+    result = rx.assembly.add(chunk);
+    if (result == ImageAssembly::CHUNK_PARITY || rx.assembly.recoveredChunks() != recovered) {
+      rx.fecNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ta).count();
+    }
+  }
+  rx.cpuNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+  ++rx.packets;
+  if (result == ImageAssembly::CHUNK_INVALID || result == ImageAssembly::CHUNK_CORRUPT) return;
+
+  bool lastChunk = espNowIsLastPacket(chunk);
+  bool progress = result == ImageAssembly::CHUNK_NEW || result == ImageAssembly::CHUNK_PARITY;
+  if (progress) rx.lastActivity = millis();
+  if (progress && rx.assembly.complete() && !rx.assembly.verify()) {
+    rx.assembly.restart(); // Bild-CRC falsch: alles neu anfordern
+    rxSendNack();
+  } else if (rx.assembly.complete()) {
+    // Neu vollständig oder Wiederholung nach verpasstem ACK: (erneut) bestätigen
+    if (progress || lastChunk) rxSendNack();
+  } else if (lastChunk) {
+    rxSendNack();
+  }
+}
+
+static void rxTick() {
+  if (!rx.assembly.active() || rx.assembly.complete()) return;
+  if (millis() - rx.lastActivity > SIM_NACK_SILENCE_MS && rx.nackAttempts < SIM_NACK_MAX_ATTEMPTS) {
+    ++rx.nackAttempts;
+    rx.lastActivity = millis();
+    rxSendNack();
+  }
+}
+
+// ───────── Szenarien ─────────
+struct Scenario {
+  const char* name;
+  uint8_t version;
+  float lossRate;
+  float burstLength;
+  uint32_t jitterUs;
+  float corruptRate;    // Datenpakete mit gekipptem Bit
+  bool crc;             // Chunk-/Bild-CRC (nur v2)
+  bool mustDeliver;     // Bild muss in jedem Lauf unverändert ankommen
+  uint8_t fecM;         // Paritäten je SIM_FEC_K Chunks (nur v2)
+};
+
+static const Scenario scenarios[] = {
+  { "verlustfrei",         1, 0.00f, 1, 0,    0.00f, false, true,  0 },
+  { "verlustfrei",         2, 0.00f, 1, 0,    0.00f, true,  true,  0 },
+  { "2% einzeln",          1, 0.02f, 1, 2000, 0.00f, false, true,  0 },
+  { "2% einzeln",          2, 0.02f, 1, 2000, 0.00f, true,  true,  0 },
+  { "10% einzeln",         1, 0.10f, 1, 2000, 0.00f, false, true,  0 },
+  { "10% einzeln",         2, 0.10f, 1, 2000, 0.00f, true,  true,  0 },
+  { "10% Bursts (8)",      1, 0.10f, 8, 2000, 0.00f, false, false, 0 },
+  { "10% Bursts (8)",      2, 0.10f, 8, 2000, 0.00f, true,  false, 0 },
+  { "25% Bursts (4)",      1, 0.25f, 4, 5000, 0.00f, false, false, 0 },
+  { "25% Bursts (4)",      2, 0.25f, 4, 5000, 0.00f, true,  false, 0 },
+  { "1% Bitfehler",        2, 0.02f, 1, 2000, 0.01f, false, false, 0 },
+  { "1% Bitfehler+CRC",    2, 0.02f, 1, 2000, 0.01f, true,  true,  0 },
+  { "5% Bitfehler+CRC",    2, 0.02f, 1, 2000, 0.05f, true,  true,  0 },
+  { "2% einzeln FEC1",     2, 0.02f, 1, 2000, 0.00f, true,  true,  1 },
+  { "10% einzeln FEC1",    2, 0.10f, 1, 2000, 0.00f, true,  true,  1 },
+  { "10% einzeln FEC2",    2, 0.10f, 1, 2000, 0.00f, true,  true,  2 },
+  { "10% Bursts FEC2",     2, 0.10f, 8, 2000, 0.00f, true,  false, 2 },
+  { "25% Bursts FEC2",     2, 0.25f, 4, 5000, 0.00f, true,  false, 2 },
+  { "5% Bitf. CRC FEC1",   2, 0.02f, 1, 2000, 0.05f, true,  true,  1 },
+};
+
+static const char* resultName(EspNowSender::Result r) {
+  switch (r) {
+    case EspNowSender::ACKED:        return "ACKED";
+    case EspNowSender::NO_RESPONSE:  return "NO_RESPONSE";
+    case EspNowSender::SEND_ERROR:   return "SEND_ERROR";
+    case EspNowSender::CHUNK_FAILED: return "CHUNK_FAILED";
+    case EspNowSender::STALLED:      return "STALLED";
+    case EspNowSender::INCOMPLETE:   return "INCOMPLETE";
+  }
+  return "?";
+}
+
+struct ScenarioTotals {
+  uint64_t bytes, timeUs, cpuNs, fecNs, ackLatencyUs, wakeLatencyUs;
+  uint32_t chunks, sent, retransmissions, nackRounds, runs, delivered, reordered, rxPackets, undetected, recovered;
+};
+
+// Ein Bild über die simulierte Strecke; true wenn es unverändert beim Empfänger ankam
+// und der Sender Erfolg meldet (NO_RESPONSE: letztes ACK verloren, MAC-ACKs zählen)
+static bool runImage(const Scenario& sc, uint32_t seed, uint32_t imageId, ScenarioTotals& tot) {
+  SimRadioConfig radio = { sc.lossRate, sc.burstLength, sc.jitterUs, sc.corruptRate, 1000, 8, seed };
+  simRadioBegin(radio, rxReceive, rxTick);
+  rx.assembly.reset();
+  rx.cpuNs = 0;
+  rx.fecNs = 0;
+  rx.packets = 0;
+
+  camera_fb_t* fb = esp_camera_fb_get();
+  EspNowTxImage img;
+  uint16_t maxPayload = sc.version == ESP_NOW_PROTOCOL_V1 ? ESP_NOW_MAX_PAYLOAD : ESP_NOW_MAX_PAYLOAD_LARGE;
+  if (!espNowTxImageInit(img, fb->buf, fb->len, imageId, 3700, sc.version, maxPayload, sc.crc,
+                         0, nullptr, 0, SIM_FEC_K, sc.fecM)) {
+    printf("  %s: zu gross fuer ESP-NOW (%u Bytes)\n", simCameraName(fb), (unsigned)fb->len);
+    esp_camera_fb_return(fb);
+    return false;
+  }
+
+  EspNowSender::Stats stats;
+  uint64_t t0 = simRadioNowUs();
+  EspNowSender::Result result = sender.send(receiverMac, img, stats);
+  uint64_t dt = simRadioNowUs() - t0;
+  delay(SIM_NACK_SILENCE_MS * 2); // ausstehende Pakete zustellen
+
+  bool intact = rx.assembly.complete() && rx.assembly.totalSize() == fb->len &&
+                memcmp(rx.buffer.data(), fb->buf, fb->len) == 0;
+  bool undetected = rx.assembly.complete() && !intact; // würde beschädigt angezeigt
+  if (undetected) tot.undetected++;
+  if (result == EspNowSender::ACKED && !intact && sc.mustDeliver) {
+    printf("  FEHLER %s: Sender meldet ACKED, Bild beim Empfaenger fehlerhaft\n", simCameraName(fb));
+  } else if (!intact && sc.mustDeliver) {
+    printf("  FEHLER %s: %s nach %u Sendungen\n", simCameraName(fb), resultName(result), stats.sent);
+  }
+
+  tot.bytes += fb->len;
+  tot.timeUs += dt;
+  tot.cpuNs += rx.cpuNs;
+  tot.fecNs += rx.fecNs;
+  tot.recovered += rx.assembly.recoveredChunks();
+  tot.rxPackets += rx.packets;
+  tot.chunks += img.total_chunks;
+  tot.sent += stats.sent;
+  tot.retransmissions += stats.retransmissions;
+  tot.nackRounds += stats.nackRounds;
+  tot.ackLatencyUs += stats.ackLatencyAvgUs;
+  tot.wakeLatencyUs += stats.wakeLatencyAvgUs;
+  tot.reordered += simRadioStats().reordered;
+  tot.runs++;
+  bool ok = intact && (result == EspNowSender::ACKED || result == EspNowSender::NO_RESPONSE);
+  if (ok) tot.delivered++;
+  esp_camera_fb_return(fb);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  const char* fixtureDir = argc > 1 ? argv[1] : "data/bench";
+  int repeats = argc > 2 ? atoi(argv[2]) : 5;
+  if (repeats < 1) repeats = 1;
+
+  size_t images = simCameraLoad(fixtureDir);
+  printf("EcoSnapCam ESP-NOW Simulation: %u Bilder%s, %d Wiederholungen, 1 Mbit/s, Fenster %u\n",
+         (unsigned)images, simCameraSynthetic() ? " (synthetisch, keine Fixtures in data/bench)" : "",
+         repeats, SIM_WINDOW_SIZE);
+
+  rx.buffer.resize(SIM_RX_BUFFER_SIZE);
+  rx.parity.resize(SIM_FEC_PARITY_SLOTS * ESP_NOW_MAX_PAYLOAD_LARGE);
+  rx.assembly.setParityStore(rx.parity.data(), rx.parity.size());
+  esp_now_register_send_cb(OnDataSent);
+  esp_now_register_recv_cb(OnDataRecv);
+
+  printf("%-17s %-3s %9s %10s %7s %6s %9s %6s %9s %7s %7s %8s %7s %8s\n",
+         "Szenario", "Ver", "kB/s", "Send/Chunk", "Wdh.", "NACK", "umsort.", "ok", "ns/Paket", "unerk.", "ACK us", "Reakt.us",
+         "FEC-Ers", "FEC us");
+  int failures = 0;
+  uint32_t imageId = 1;
+  for (const Scenario& sc : scenarios) {
+    ScenarioTotals tot = {};
+    for (int rep = 0; rep < repeats; ++rep) {
+      for (size_t i = 0; i < images; ++i) {
+        bool ok = runImage(sc, 1000 * rep + i + 1, imageId++, tot);
+        if (!ok && sc.mustDeliver) ++failures;
+      }
+    }
+    printf("%-17s v%-2u %9.1f %10.2f %7.1f %6.2f %9.1f %3u/%-3u %8.0f %7u %7.0f %8.0f %7.1f %8.1f\n",
+           sc.name, sc.version,
+           tot.timeUs ? tot.bytes * 1000.0 / tot.timeUs : 0.0,    // Bytes/µs * 1000 = kB/s
+           tot.chunks ? (double)tot.sent / tot.chunks : 0.0,
+           (double)tot.retransmissions / tot.runs,
+           (double)tot.nackRounds / tot.runs,
+           (double)tot.reordered / tot.runs,
+           tot.delivered, tot.runs,
+           tot.rxPackets ? (double)tot.cpuNs / tot.rxPackets : 0.0,
+           tot.undetected,
+           (double)tot.ackLatencyUs / tot.runs,
+           (double)tot.wakeLatencyUs / tot.runs,
+           (double)tot.recovered / tot.runs,               // per FEC ersetzte Chunks je Bild
+           tot.fecNs / 1000.0 / tot.runs);                 // FEC-Dekodierung je Bild
+  }
+
+  if (failures > 0) {
+    printf("%d Uebertragungen fehlgeschlagen.\n", failures);
+    return 1;
+  }
+  printf("Alle Pflicht-Szenarien fehlerfrei.\n");
+  return 0;
+}
@@ -0,0 +1,40 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – Arduino-Ersatz für die native-Umgebung
+//  Nur was lib/EcoSnapProtocol braucht. Zeit ist die virtuelle Zeit
+//  der Funksimulation (SimRadio): delay() lässt sie vorlaufen und
+//  stellt dabei fällige Pakete und Sende-Callbacks zu, ebenso das
+//  Warten auf eine Task-Notification (bis zur ersten Notification).
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_SIM_ARDUINO_H
+#define ECOSNAP_SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// Die Simulation läuft in einem Thread, Callbacks kommen nur aus delay()
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+// FreeRTOS-Task-Notifications, 1 Tick = 1 ms
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+
+#endif // ECOSNAP_SIM_ARDUINO_H
@@ -0,0 +1,23 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – Kamera-Ersatz für die native-Umgebung
+//  esp_camera_fb_get() liefert reihum die geladenen JPEG-Fixtures.
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_SIM_ESP_CAMERA_H
+#define ECOSNAP_SIM_ESP_CAMERA_H
+
+#include "Arduino.h"
+
+typedef enum { PIXFORMAT_JPEG } pixformat_t;
+
+typedef struct {
+  uint8_t* buf;
+  size_t len;
+  size_t width;
+  size_t height;
+  pixformat_t format;
+} camera_fb_t;
+
+camera_fb_t* esp_camera_fb_get();
+void esp_camera_fb_return(camera_fb_t* fb);
+
+#endif // ECOSNAP_SIM_ESP_CAMERA_H
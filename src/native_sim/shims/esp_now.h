@@ -0,0 +1,25 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – ESP-NOW Ersatz für die native-Umgebung
+//  esp_now_send() und die Callbacks laufen über SimRadio.
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_SIM_ESP_NOW_H
+#define ECOSNAP_SIM_ESP_NOW_H
+
+#include "Arduino.h"
+
+#define ESP_NOW_ETH_ALEN 6
+#define ESP_NOW_MAX_DATA_LEN 250
+#define ESP_NOW_MAX_DATA_LEN_V2 1470  // wie IDF >= 5.4, damit v2 mit großen Paketen simuliert wird
+#define ESP_ERR_ESPNOW_BASE 0x3066
+#define ESP_ERR_ESPNOW_NO_MEM (ESP_ERR_ESPNOW_BASE + 2)
+#define ESP_ERR_ESPNOW_ARG (ESP_ERR_ESPNOW_BASE + 5)
+
+typedef enum { ESP_NOW_SEND_SUCCESS = 0, ESP_NOW_SEND_FAIL } esp_now_send_status_t;
+typedef void (*esp_now_send_cb_t)(const uint8_t* mac, esp_now_send_status_t status);
+typedef void (*esp_now_recv_cb_t)(const uint8_t* mac, const uint8_t* data, int len);
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb);
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb);
+esp_err_t esp_now_send(const uint8_t* mac, const uint8_t* data, size_t len);
+
+#endif // ECOSNAP_SIM_ESP_NOW_H
@@ -5,128 +5,1461 @@
 // User_Setup.h wird nicht mehr benötigt, Konfiguration erfolgt über platformio.ini build_flags
 #include <TFT_eSPI.h>
 #include <TJpg_Decoder.h>
+#include <LittleFS.h>
 
 // WLAN-Kanal für ESP-NOW (muss mit dem Sender übereinstimmen)
 // WICHTIG: Passen Sie ESP_NOW_CHANNEL in der config.h des Senders an diesen Wert an!
 #define ESP_NOW_RECEIVER_CHANNEL 1
 
-// Definition der Chunk-Struktur (muss mit der Sender-Struktur übereinstimmen)
-// Header: image_id (4), total_size (4), chunk_index (2), total_chunks (2), data_len (1), vbat_mv_high (1), vbat_mv_low (1) = 15 Bytes
-#define ESP_NOW_MAX_DATA_PER_CHUNK (250 - 15) 
-
-typedef struct __attribute__((packed)) esp_now_image_chunk_t {
-    uint32_t image_id;
-    uint32_t total_size;
-    uint16_t chunk_index;
-    uint16_t total_chunks;
-    uint8_t  data_len;
-    uint8_t  vbat_mv_high;
-    uint8_t  vbat_mv_low;
-    uint8_t  data[ESP_NOW_MAX_DATA_PER_CHUNK];
-} esp_now_image_chunk_t;
+// Chunk-Struktur und Protokollkonstanten (gemeinsam mit dem Sender)
+#include "EspNowProtocol.h"
+#include "ImageAssembly.h"
+#include "PacketRing.h"
+#include "WakeProfile.h"
+#include "EcoLog.h"
+
+// NACK-Steuerung: Nach dieser Funkstille wird die Liste fehlender Chunks an den Sender geschickt
+#define NACK_SILENCE_MS 100
+#define NACK_MAX_ATTEMPTS 5
+// Empfangsqualität (RSSI, Verlust) je Bild an den Sender melden; er wählt damit Datenrate und Sendeleistung
+#define LINK_REPORT 1
+
+// Empfangs-Queue zwischen WiFi-Callback und Verarbeitungs-Task (Zweierpotenz)
+#if ESP_NOW_MAX_PAYLOAD_LARGE > ESP_NOW_MAX_PAYLOAD
+#define RX_QUEUE_SLOTS 16 // Große v2-Pakete: weniger Slots, gleicher Speicherbedarf
+#else
+#define RX_QUEUE_SLOTS 32
+#endif
+// Anzahl gleichzeitiger Empfänge (mehrere Kameras) und Puffergröße je Slot
+#define RX_SLOT_COUNT 3
+#define RX_SLOT_BUFFER_SIZE 60000           // ohne PSRAM (interner RAM)
+#define RX_SLOT_BUFFER_SIZE_PSRAM 262144    // mit PSRAM: auch große Nachtbilder
+// Vorwärtsfehlerkorrektur: Paritäts-Chunks zwischenspeichern und fehlende Chunks ohne NACK ersetzen
+#define FEC_RECEIVE 1
+#define FEC_PARITY_SLOTS 4                  // Paritäts-Chunks je Slot (interner RAM, max. Paketgröße)
+// Progressive Anzeige: JPEG wird bereits während des Empfangs von oben nach unten gezeichnet
+#define PROGRESSIVE_DISPLAY 1
+#define STREAM_WAIT_MS 1500 // Max. Wartezeit auf einen fehlenden Chunk, danach Abbruch
+#ifdef TJPGD_WORKSPACE_SIZE
+#define STREAM_WORKSPACE_SIZE TJPGD_WORKSPACE_SIZE
+#else
+#define STREAM_WORKSPACE_SIZE 7168
+#endif
+// DMA-Pipeline: Dekodieren (loop, Core 1) und SPI-Übertragung (blitTask, Core 0) laufen parallel
+#define DMA_PIPELINE 1
+#define STRIP_MAX_HEIGHT 16 // Max. MCU-Höhe (4:2:0 Subsampling)
+// Bildwiederholrate für die Fortschrittsanzeige
+#define UI_FPS 10
+// Bildverlauf: letzte Bilder als JPEG mit vorab dekodiertem Vorschaubild, Übersicht über die BOOT-Taste
+#define IMAGE_HISTORY 1
+#define HISTORY_MAX_IMAGES 12               // Kacheln der Übersicht (4x3 bei 80x60)
+#define HISTORY_BUDGET_BYTES (1024 * 1024)  // JPEGs + Vorschaubilder (PSRAM bzw. LittleFS)
+#define HISTORY_FLASH 0                     // 1 = auch mit PSRAM im LittleFS (übersteht Neustart); ohne PSRAM immer
+#define HIST_THUMB_W 80
+#define HIST_THUMB_H 60
+#define BROWSE_BUTTON_PIN 0                 // BOOT-Taste des CYD
+#define BROWSE_LONG_PRESS_MS 600
+#define BROWSE_TIMEOUT_MS 30000             // Ohne Tastendruck zurück zur Live-Anzeige
+// Live-Modus des Senders: Bildrate und Latenz einblenden, Statistik im Log alle LIVE_LOG_MS
+#define LIVE_LOG_MS 5000
 
 TFT_eSPI tft = TFT_eSPI(); // TFT_eSPI Objekt initialisieren
 
-// Puffer für das zusammengesetzte Bild
-uint8_t* imageDataBuffer = nullptr;
-uint32_t imageBufferSize = 0;
-uint32_t currentImageId = 0;
-uint32_t receivedImageBytes = 0;
-uint16_t lastVBat_mV = 0;
+// Der WiFi-Callback kopiert nur in diesen Ringpuffer; alles Weitere macht rxTask
+static PacketRing<RX_QUEUE_SLOTS, ESP_NOW_MAX_PAYLOAD_LARGE> rxQueue;
+static TaskHandle_t rxTaskHandle = nullptr;
+
+// ───────── Empfangs-Slots (nur rxTask vergibt und füllt sie) ─────────
+// Pro gleichzeitig sendender Kamera ein Slot, Zuordnung über Sender-MAC + image_id.
+// Die Bildpuffer werden einmalig beim Start belegt (PSRAM, falls vorhanden).
+struct RxSlot {
+  enum State : uint8_t { FREE, RECEIVING, READY };
+  volatile State state;        // FREE→RECEIVING→READY durch rxTask, READY→FREE durch loop()
+  uint8_t  mac[6];
+  ImageAssembly assembly;
+  uint8_t* buffer;
+  uint32_t capacity;
+  uint16_t vbat_mV;
+  WakeProfile profile;         // Wachzeit-Profil des Senders aus Chunk 0
+  bool     hasProfile;
+  unsigned long lastActivity;
+  uint8_t  nackAttempts;
+  bool     nackRequested;      // Letzter Chunk empfangen, Lücken melden
+  int32_t  rssiSum;            // Empfangsqualität dieses Bildes für den LINK-Bericht
+  uint16_t rssiCount;
+  int8_t   rssiMin;
+  uint16_t corruptChunks;
+  uint16_t firstPassMissing;   // fehlende Chunks, als der letzte Chunk zum ersten Mal kam (0xFFFF: noch nicht)
+  volatile bool streaming;     // loop() dekodiert gerade progressiv aus diesem Slot
+  bool     streamed;           // Progressive Anzeige war erfolgreich
+  bool     live;               // Bild aus dem Live-Modus des Senders (ESP_NOW_FLAG_LIVE)
+  uint16_t liveSeq;
+  uint16_t liveAgeMs;          // Aufnahme bis Sendebeginn laut Sender
+  unsigned long firstPacketMs; // erstes Paket dieses Bildes empfangen
+  unsigned long shownMs;       // progressive Anzeige abgeschlossen
+};
+static RxSlot rxSlots[RX_SLOT_COUNT];
+static uint8_t rxSlotsAllocated = 0;
+static bool fecAvailable = false;   // alle Slots haben einen Paritäts-Speicher
+
+// Zuletzt abgeschlossene Bilder je Sender, um wiederholte Chunks erneut zu bestätigen
+struct CompletedImage {
+  uint8_t  mac[6];
+  uint32_t imageId;
+};
+static CompletedImage recentCompleted[RX_SLOT_COUNT * 2];
+static uint8_t recentCompletedNext = 0;
+static bool ackRequested = false;
+static CompletedImage ackTarget;
+
+// Fertige Slots in Empfangsreihenfolge, loop() zeigt sie nacheinander an
+static QueueHandle_t displayQueue = nullptr;
 
-volatile bool imageReceiveInProgress = false;
-volatile bool newImageReadyToDisplay = false;
+#if PROGRESSIVE_DISPLAY
+// Neu begonnene Empfänge, für die loop() eine progressive Anzeige starten kann
+struct StreamRequest {
+  uint8_t  slot;
+  uint32_t imageId;
+};
+static QueueHandle_t streamQueue = nullptr;
+static uint32_t uiStreamedImageId = 0; // Fortschrittsanzeige für dieses Bild unterdrücken
+#endif
+
+// ───────── Fortschritt für die UI (rxTask schreibt, loop() liest) ─────────
+struct RxProgress {
+  uint32_t imageId;
+  uint32_t totalSize;
+  uint16_t receivedChunks;
+  uint16_t totalChunks;
+  uint8_t  mac[6];
+  bool     live;               // Live-Bilder ohne Fortschrittsanzeige
+  bool     allocError;
+};
+static RxProgress rxProgress = {};
+static portMUX_TYPE rxProgressMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Letztes Lebenszeichen ohne Bild (Kamera hat keine Änderung erkannt), ebenfalls unter rxProgressMux
+struct RxHeartbeat {
+  uint8_t  mac[6];
+  uint16_t vbat_mV;
+  uint8_t  sceneDiff;
+  bool     pending;
+};
+static RxHeartbeat rxHeartbeat = {};
+
+#if DMA_PIPELINE
+// ───────── Dekodier-/Blit-Pipeline ─────────
+// tft_output sammelt die MCU-Blöcke einer MCU-Zeile in einem von zwei Streifenpuffern.
+// Ist die Zeile komplett, überträgt blitTask (Core 0) den Streifen per pushImageDMA,
+// während der Decoder (Core 1) bereits den anderen Streifen füllt.
+struct BlitJob {
+  int16_t  x, y;
+  uint16_t w, h;
+  uint8_t  buf;
+};
+static uint16_t* stripBuf[2] = { nullptr, nullptr };
+static QueueHandle_t blitQueue = nullptr;  // gefüllte Streifen → blitTask
+static QueueHandle_t freeStrips = nullptr; // freie Streifen → Decoder
+static bool dmaPipelineEnabled = false;
+static int8_t  stripCur = -1;              // Streifen, der gerade gefüllt wird
+static int16_t stripX, stripW, stripY, stripH;
+
+static void blitTask(void*) {
+  BlitJob job;
+  for (;;) {
+    xQueueReceive(blitQueue, &job, portMAX_DELAY);
+    tft.startWrite();
+    tft.pushImageDMA(job.x, job.y, job.w, job.h, stripBuf[job.buf]);
+    tft.dmaWait();
+    tft.endWrite();
+    xQueueSend(freeStrips, &job.buf, portMAX_DELAY);
+  }
+}
+
+static bool initBlitPipeline() {
+  size_t stripBytes = tft.width() * STRIP_MAX_HEIGHT * sizeof(uint16_t);
+  for (uint8_t i = 0; i < 2; ++i) {
+    stripBuf[i] = (uint16_t*)heap_caps_malloc(stripBytes, MALLOC_CAP_DMA);
+    if (stripBuf[i] == nullptr) return false;
+  }
+  if (!tft.initDMA()) return false;
+  blitQueue = xQueueCreate(2, sizeof(BlitJob));
+  freeStrips = xQueueCreate(2, sizeof(uint8_t));
+  for (uint8_t i = 0; i < 2; ++i) xQueueSend(freeStrips, &i, 0);
+  xTaskCreatePinnedToCore(blitTask, "tft_blit", 2048, nullptr, 4, nullptr, 0);
+  return true;
+}
+
+static void blitFlush() {
+  if (stripCur < 0) return;
+  BlitJob job = { stripX, stripY, (uint16_t)stripW, (uint16_t)stripH, (uint8_t)stripCur };
+  xQueueSend(blitQueue, &job, portMAX_DELAY);
+  stripCur = -1;
+}
+
+// Kopiert einen MCU-Block in den aktuellen Streifen; eine neue MCU-Zeile beginnt einen neuen Streifen
+static void blitBlock(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t* px) {
+  if (stripCur >= 0 && y != stripY) blitFlush();
+  if (stripCur < 0) {
+    uint8_t idx;
+    xQueueReceive(freeStrips, &idx, portMAX_DELAY); // wartet, falls beide Streifen noch übertragen werden
+    stripCur = idx;
+    stripY = y;
+    stripH = 0;
+  }
+  int16_t rows = min((int16_t)h, (int16_t)min(STRIP_MAX_HEIGHT, tft.height() - y));
+  if (rows > stripH) stripH = rows;
+  int16_t cx0 = max(x, stripX);
+  int16_t cx1 = min((int16_t)(x + w), (int16_t)(stripX + stripW));
+  if (cx1 <= cx0) return;
+  for (int16_t r = 0; r < rows; ++r) {
+    memcpy(stripBuf[stripCur] + r * stripW + (cx0 - stripX), px + r * w + (cx0 - x), (cx1 - cx0) * sizeof(uint16_t));
+  }
+}
+#endif
+
+// Vor dem Dekodieren: sichtbaren Bildbereich für die Streifen festlegen
+static void decodeBegin(int16_t x0, uint16_t scaledW) {
+#if DMA_PIPELINE
+  if (!dmaPipelineEnabled) return;
+  stripX = max(x0, (int16_t)0);
+  stripW = min((int16_t)(x0 + scaledW), tft.width()) - stripX;
+  stripCur = -1;
+#endif
+}
+
+// Nach dem Dekodieren: letzten Streifen senden und warten, bis die Pipeline leer ist
+static void decodeEnd() {
+#if DMA_PIPELINE
+  if (!dmaPipelineEnabled) return;
+  blitFlush();
+  uint8_t a, b;
+  xQueueReceive(freeStrips, &a, portMAX_DELAY);
+  xQueueReceive(freeStrips, &b, portMAX_DELAY);
+  xQueueSend(freeStrips, &a, 0);
+  xQueueSend(freeStrips, &b, 0);
+#endif
+}
 
 // Callback-Funktion für TJpg_Decoder, um Pixeldaten auf das Display zu schreiben
 bool tft_output(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap) {
   if (y >= tft.height()) return false; // Stoppt, wenn das Bild über den Bildschirmrand hinausgeht
+  if (x >= tft.width() || x + w <= 0 || y + h <= 0) return true; // Block komplett außerhalb, kein SPI-Transfer
+#if DMA_PIPELINE
+  if (dmaPipelineEnabled) {
+    blitBlock(x, y, w, h, bitmap);
+    return true;
+  }
+#endif
   tft.pushImage(x, y, w, h, bitmap);
   return true; // Weiter mit dem nächsten Block
 }
 
-// Callback-Funktion für den Empfang von ESP-NOW Daten
-void OnDataRecv(const uint8_t * mac, const uint8_t *incomingData, int len) {
-  if (len < sizeof(esp_now_image_chunk_t) - ESP_NOW_MAX_DATA_PER_CHUNK) { // Mindestgröße eines Chunks (Header)
-    Serial.println("Empfangenes Paket zu klein.");
-    return;
+// Liest Breite und Höhe aus dem SOF-Marker eines JPEG-Puffers
+static bool jpegSize(const uint8_t* buf, uint32_t len, uint16_t& w, uint16_t& h) {
+  if (len < 4 || buf[0] != 0xFF || buf[1] != 0xD8) return false;
+  uint32_t i = 2;
+  while (i + 9 <= len) {
+    if (buf[i] != 0xFF) return false;
+    uint8_t marker = buf[i + 1];
+    if (marker == 0xFF) { ++i; continue; } // Füllbytes
+    if (marker == 0xDA || marker == 0xD9) return false; // Bilddaten ohne vorherigen SOF
+    // SOF0..SOF15, außer DHT (C4), JPG (C8) und DAC (CC)
+    if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+      h = (buf[i + 5] << 8) | buf[i + 6];
+      w = (buf[i + 7] << 8) | buf[i + 8];
+      return true;
+    }
+    i += 2 + ((buf[i + 2] << 8) | buf[i + 3]);
   }
+  return false;
+}
+
+// Kleinste Verkleinerung (1, 2, 4 oder 8), bei der das Bild vollständig auf das Display passt
+static uint8_t fitScale(uint16_t w, uint16_t h) {
+  uint8_t scale = 1;
+  while (scale < 8 && ((w + scale - 1) / scale > tft.width() || (h + scale - 1) / scale > tft.height())) {
+    scale <<= 1;
+  }
+  return scale;
+}
+
+// Bildposition für zentrierte Anzeige bei gegebener Skalierung
+static void centerImage(uint16_t w, uint16_t h, uint8_t scale, int16_t& x, int16_t& y) {
+  x = (tft.width() - (int16_t)((w + scale - 1) / scale)) / 2;
+  y = (tft.height() - (int16_t)((h + scale - 1) / scale)) / 2;
+}
+
+static void publishProgress(const RxSlot& slot) {
+  portENTER_CRITICAL(&rxProgressMux);
+  rxProgress.imageId = slot.assembly.imageId();
+  rxProgress.totalSize = slot.assembly.totalSize();
+  rxProgress.receivedChunks = slot.assembly.receivedChunks();
+  rxProgress.totalChunks = slot.assembly.totalChunks();
+  memcpy(rxProgress.mac, slot.mac, 6);
+  rxProgress.live = slot.live;
+  portEXIT_CRITICAL(&rxProgressMux);
+}
+
+static void publishAllocError() {
+  portENTER_CRITICAL(&rxProgressMux);
+  rxProgress.allocError = true;
+  portEXIT_CRITICAL(&rxProgressMux);
+}
 
-  esp_now_image_chunk_t chunk;
-  memcpy(&chunk, incomingData, sizeof(esp_now_image_chunk_t)); // Kopiere den vollen Chunk, auch wenn data nicht voll ist
+// Belegt die Bildpuffer für alle Slots einmalig beim Start
+static void allocateSlots() {
+  bool psram = psramFound();
+  uint32_t size = psram ? RX_SLOT_BUFFER_SIZE_PSRAM : RX_SLOT_BUFFER_SIZE;
+  for (uint8_t i = 0; i < RX_SLOT_COUNT; ++i) {
+    uint8_t* buf = psram ? (uint8_t*)ps_malloc(size) : (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    if (buf == nullptr) break;
+    rxSlots[i].buffer = buf;
+    rxSlots[i].capacity = size;
+    rxSlots[i].state = RxSlot::FREE;
+    ++rxSlotsAllocated;
+  }
+  ECO_LOGI("%u/%u Empfangs-Slots a %u Bytes belegt (%s).", rxSlotsAllocated, RX_SLOT_COUNT,
+                size, psram ? "PSRAM" : "interner RAM");
+#if FEC_RECEIVE
+  // Paritäten werden bei jedem Verlust gelesen und verrechnet: interner RAM statt PSRAM
+  uint32_t paritySize = FEC_PARITY_SLOTS * ESP_NOW_MAX_PAYLOAD_LARGE;
+  fecAvailable = rxSlotsAllocated > 0;
+  for (uint8_t i = 0; i < rxSlotsAllocated; ++i) {
+    uint8_t* buf = (uint8_t*)heap_caps_malloc(paritySize, MALLOC_CAP_8BIT);
+    rxSlots[i].assembly.setParityStore(buf, paritySize);
+    if (buf == nullptr) fecAvailable = false;
+  }
+  if (!fecAvailable) ECO_LOGW("Kein Speicher für FEC-Paritaeten, Sender sendet ohne FEC.");
+#endif
+}
 
-  // Erster Chunk eines neuen Bildes oder Bild-ID hat sich geändert
-  if (chunk.chunk_index == 0 || (imageReceiveInProgress && chunk.image_id != currentImageId) ) {
-    if (imageDataBuffer != nullptr) {
-      free(imageDataBuffer);
-      imageDataBuffer = nullptr;
+static RxSlot* findSlot(const uint8_t* mac, uint32_t imageId) {
+  for (uint8_t i = 0; i < rxSlotsAllocated; ++i) {
+    RxSlot& slot = rxSlots[i];
+    if (slot.state == RxSlot::RECEIVING && slot.assembly.imageId() == imageId &&
+        memcmp(slot.mac, mac, 6) == 0) {
+      return &slot;
     }
-    imageBufferSize = chunk.total_size;
-    imageDataBuffer = (uint8_t*)malloc(imageBufferSize);
+  }
+  return nullptr;
+}
 
-    if (imageDataBuffer == nullptr) {
-      Serial.printf("Fehler: Konnte nicht %u Bytes für Bild ID %u reservieren.\n", imageBufferSize, chunk.image_id);
-      tft.fillScreen(TFT_RED);
-      tft.setCursor(10, 10);
-      tft.setTextSize(2);
-      tft.setTextColor(TFT_WHITE);
-      tft.println("Speicherfehler!");
-      imageReceiveInProgress = false;
+// Laufender Empfang eines Senders unabhängig von der Bild-ID (nur lesend, für Statistik)
+static RxSlot* findSenderSlot(const uint8_t* mac) {
+  for (uint8_t i = 0; i < rxSlotsAllocated; ++i) {
+    RxSlot& slot = rxSlots[i];
+    if (slot.state == RxSlot::RECEIVING && memcmp(slot.mac, mac, 6) == 0) return &slot;
+  }
+  return nullptr;
+}
+
+// Freier Slot oder – falls keiner frei – der am längsten inaktive unvollständige Empfang (LRU)
+static RxSlot* claimSlot(const uint8_t* mac) {
+  RxSlot* victim = nullptr;
+  for (uint8_t i = 0; i < rxSlotsAllocated; ++i) {
+    RxSlot& slot = rxSlots[i];
+    if (slot.state == RxSlot::FREE) return &slot;
+    if (slot.state != RxSlot::RECEIVING || slot.streaming) continue;
+    // Ein neues Bild desselben Senders ersetzt dessen alten Empfang sofort
+    if (memcmp(slot.mac, mac, 6) == 0) return &slot;
+    if (victim == nullptr || (long)(slot.lastActivity - victim->lastActivity) < 0) victim = &slot;
+  }
+  return victim;
+}
+
+static bool wasCompleted(const uint8_t* mac, uint32_t imageId) {
+  for (const CompletedImage& done : recentCompleted) {
+    if (done.imageId == imageId && memcmp(done.mac, mac, 6) == 0) return true;
+  }
+  return false;
+}
+
+// Fügt den Sender als ESP-NOW Peer hinzu, damit NACKs zurückgeschickt werden können
+static bool ensurePeer(const uint8_t* mac) {
+  if (esp_now_is_peer_exist(mac)) return true;
+  esp_now_peer_info_t peer = {};
+  memcpy(peer.peer_addr, mac, 6);
+  peer.channel = ESP_NOW_RECEIVER_CHANNEL;
+  peer.encrypt = false;
+  return esp_now_add_peer(&peer) == ESP_OK;
+}
+
+// Teilt dem Sender Protokollversion, maximale Paketgröße und Merkmale (FEC) dieses Empfängers mit
+static void sendCaps(const uint8_t* mac) {
+  if (!ensurePeer(mac)) return;
+  esp_now_caps_ext_t caps = { { ESP_NOW_CTRL_MAGIC, ESP_NOW_CTRL_CAPS, ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD_LARGE },
+                              (uint8_t)(fecAvailable ? ESP_NOW_CAPS_FEATURE_FEC : 0) };
+  esp_now_send(mac, (const uint8_t*)&caps, sizeof(caps));
+}
+
+// Startet ein neues Bild in einem Slot; ein dort laufender Empfang wird verworfen
+static RxSlot* startImage(const uint8_t* mac, const EspNowChunk& chunk) {
+  RxSlot* slot = claimSlot(mac);
+  if (slot == nullptr) {
+    ECO_LOGW("Kein freier Slot für Bild ID %u, Chunk verworfen.", chunk.image_id);
+    return nullptr;
+  }
+  if (slot->state == RxSlot::RECEIVING) {
+    ECO_LOGW("Verwerfe unvollstaendiges Bild ID %u (%u/%u Chunks).",
+                  slot->assembly.imageId(), slot->assembly.receivedChunks(), slot->assembly.totalChunks());
+  }
+  slot->state = RxSlot::FREE;
+
+  if (chunk.total_size > slot->capacity) {
+    ECO_LOGE("Fehler: Bild ID %u mit %u Bytes passt nicht in Slot (%u Bytes).",
+                  chunk.image_id, chunk.total_size, slot->capacity);
+    publishAllocError();
+    return nullptr;
+  }
+  if (!slot->assembly.begin(chunk.image_id, chunk.total_size, chunk.total_chunks, chunk.chunk_size,
+                             slot->buffer, slot->capacity)) {
+    ECO_LOGE("Ungueltiger Bild-Header (ID %u, %u Bytes, %u Chunks).", chunk.image_id, chunk.total_size, chunk.total_chunks);
+    return nullptr;
+  }
+  memcpy(slot->mac, mac, 6);
+  slot->nackAttempts = 0;
+  slot->nackRequested = false;
+  slot->streamed = false;
+  slot->rssiSum = 0;
+  slot->rssiCount = 0;
+  slot->rssiMin = 0;
+  slot->corruptChunks = 0;
+  slot->firstPassMissing = 0xFFFF;
+  slot->hasProfile = false;
+  slot->live = chunk.chunk_index == 0 && espNowLiveFromChunk(chunk, slot->liveSeq, slot->liveAgeMs);
+  slot->firstPacketMs = millis();
+  slot->shownMs = 0;
+  slot->state = RxSlot::RECEIVING;
+  // Live-Bilder kommen nur von v2-Sendern, die CAPS schon kennen; kein Log je Bild
+  if (!slot->live) {
+    ECO_LOGI("Empfange neues Bild ID: %u von %02X:%02X, Groesse: %u Bytes, Chunks: %u (v%u)",
+                  chunk.image_id, mac[4], mac[5], chunk.total_size, chunk.total_chunks, chunk.version);
+    sendCaps(mac);
+  }
+#if PROGRESSIVE_DISPLAY
+  StreamRequest req = { (uint8_t)(slot - rxSlots), chunk.image_id };
+  xQueueSend(streamQueue, &req, 0);
+#endif
+  return slot;
+}
+
+static void sendNack(const uint8_t* mac, const esp_now_nack_t& msg, size_t msgLen) {
+  if (!ensurePeer(mac)) {
+    ECO_LOGE("Sender konnte nicht als Peer hinzugefuegt werden.");
+    return;
+  }
+  esp_err_t err = esp_now_send(mac, (const uint8_t*)&msg, msgLen);
+  if (err != ESP_OK) {
+    ECO_LOGE("NACK senden fehlgeschlagen: %s", esp_err_to_name(err));
+  } else if (msg.range_count > 0) {
+    ECO_LOGD("NACK für Bild ID %u: %u fehlende Bereiche.", msg.image_id, msg.range_count);
+  }
+}
+
+#if LINK_REPORT
+// Meldet dem Sender RSSI und Verlust des gerade vollständig empfangenen Bildes
+static void sendLink(const uint8_t* mac, const RxSlot& slot, uint32_t imageId) {
+  uint16_t total = slot.assembly.totalChunks();
+  uint16_t missing = slot.firstPassMissing == 0xFFFF ? 0 : slot.firstPassMissing;
+  uint32_t lost = missing + slot.corruptChunks + slot.assembly.recoveredChunks(); // Rohverlust, auch per FEC ersetzte
+  esp_now_link_t msg = { ESP_NOW_CTRL_MAGIC, ESP_NOW_CTRL_LINK, imageId,
+                         (int8_t)(slot.rssiCount ? slot.rssiSum / slot.rssiCount : 0), slot.rssiMin,
+                         (uint8_t)(total ? min<uint32_t>(100, lost * 100 / total) : ESP_NOW_LINK_LOSS_UNKNOWN) };
+  if (!slot.live) {
+    ECO_LOGI("Link %02X:%02X: RSSI %d dBm (min. %d), Verlust %u%%.", mac[4], mac[5], msg.rssi_avg, msg.rssi_min,
+             msg.loss_pct);
+  }
+  esp_now_send(mac, (const uint8_t*)&msg, sizeof(msg));
+}
+#endif
+
+// Verarbeitet ein Paket aus der Empfangs-Queue (läuft in rxTask)
+static void handlePacket(const uint8_t* mac, const uint8_t* incomingData, int len, int8_t rssi) {
+  if (const esp_now_heartbeat_t* hb = espNowParseHeartbeat(incomingData, len)) {
+    ECO_LOGI("Heartbeat von %02X:%02X: Szene unveraendert (Differenz %u), VBat %.2fV",
+                  mac[4], mac[5], hb->scene_diff, hb->vbat_mv / 1000.0f);
+    portENTER_CRITICAL(&rxProgressMux);
+    memcpy(rxHeartbeat.mac, mac, 6);
+    rxHeartbeat.vbat_mV = hb->vbat_mv;
+    rxHeartbeat.sceneDiff = hb->scene_diff;
+    rxHeartbeat.pending = true;
+    portEXIT_CRITICAL(&rxProgressMux);
+    return;
+  }
+
+  EspNowChunk parsed;
+  if (!espNowParseChunk(incomingData, len, parsed)) {
+    ECO_LOGW("Ungueltiges Paket verworfen.");
+    return;
+  }
+  const EspNowChunk* chunk = &parsed;
+  if (!chunk->crc_ok) {
+    // Vor jeder Slot-Suche: mit falscher CRC sind auch image_id, total_size usw. unzuverlässig und
+    // würden sonst den laufenden Empfang desselben Senders ersetzen oder einen Slot mit falscher
+    // Geometrie öffnen. Der Chunk bleibt als Lücke stehen und wird per NACK neu angefordert.
+    ECO_LOGW("Chunk %u für Bild ID %u mit falscher CRC verworfen.", chunk->chunk_index, chunk->image_id);
+    if (RxSlot* sender = findSenderSlot(mac)) ++sender->corruptChunks;
+    return;
+  }
+
+  RxSlot* slot = findSlot(mac, chunk->image_id);
+  if (slot == nullptr) {
+    if (wasCompleted(mac, chunk->image_id)) {
+      // Sender hat unser ACK verpasst und wiederholt – erneut bestätigen
+      memcpy(ackTarget.mac, mac, 6);
+      ackTarget.imageId = chunk->image_id;
+      ackRequested = true;
       return;
     }
-    Serial.printf("Empfange neues Bild ID: %u, Groesse: %u Bytes, Chunks: %u\n", chunk.image_id, imageBufferSize, chunk.total_chunks);
-    currentImageId = chunk.image_id;
-    receivedImageBytes = 0;
-    imageReceiveInProgress = true;
-    newImageReadyToDisplay = false;
+    slot = startImage(mac, *chunk);
+    if (slot == nullptr) return;
+  }
 
-    // Info auf Display
+  ImageAssembly::Result result = slot->assembly.add(*chunk);
+  if (result == ImageAssembly::CHUNK_INVALID) {
+    ECO_LOGW("Ungueltiger Chunk %u für Bild ID %u verworfen.", chunk->chunk_index, chunk->image_id);
+    return;
+  }
+  slot->lastActivity = millis();
+  if (rssi != 0) {
+    slot->rssiSum += rssi;
+    if (slot->rssiCount == 0 || rssi < slot->rssiMin) slot->rssiMin = rssi;
+    ++slot->rssiCount;
+  }
+  bool lastChunk = espNowIsLastPacket(*chunk);
+  if (lastChunk && slot->firstPassMissing == 0xFFFF) {
+    slot->firstPassMissing = slot->assembly.totalChunks() - slot->assembly.receivedChunks();
+  }
+  if (result == ImageAssembly::CHUNK_DUPLICATE) {
+    if (lastChunk) slot->nackRequested = true;
+    return;
+  }
+
+  if (result == ImageAssembly::CHUNK_NEW) {
+    slot->vbat_mV = chunk->vbat_mv;
+    if (chunk->chunk_index == 0) {
+      slot->hasProfile = wakeProfileFromChunk(*chunk, slot->profile);
+      slot->live = espNowLiveFromChunk(*chunk, slot->liveSeq, slot->liveAgeMs);
+    }
+  }
+  publishProgress(*slot);
+
+  if (slot->assembly.complete() && !slot->assembly.verify()) {
+    // Alle Chunk-CRCs stimmten, das Bild aber nicht: Zusammensetzung fehlerhaft, alles neu anfordern
+    ECO_LOGW("Bild ID %u: Bild-CRC falsch, fordere alle Chunks neu an.", chunk->image_id);
+    slot->assembly.restart();
+    slot->nackRequested = true;
+  } else if (slot->assembly.complete()) {
+    if (!slot->live) {
+      ECO_LOGI("Bild ID %u vollstaendig empfangen (%u Chunks per FEC ersetzt). Queue max %u/%u, verworfen %u.",
+                    chunk->image_id, slot->assembly.recoveredChunks(), rxQueue.highWater(), rxQueue.capacity(),
+                    rxQueue.dropped());
+    }
+    CompletedImage& done = recentCompleted[recentCompletedNext];
+    recentCompletedNext = (recentCompletedNext + 1) % (sizeof(recentCompleted) / sizeof(recentCompleted[0]));
+    memcpy(done.mac, mac, 6);
+    done.imageId = chunk->image_id;
+
+#if LINK_REPORT
+    if (ensurePeer(mac)) sendLink(mac, *slot, chunk->image_id); // vor dem ACK, danach schläft der Sender
+#endif
+    // Sofort bestätigen (NACK ohne fehlende Bereiche), danach gehört der Slot der Anzeige
+    esp_now_nack_t ack;
+    sendNack(mac, ack, slot->assembly.buildNack(ack));
+    uint8_t idx = slot - rxSlots;
+    slot->state = RxSlot::READY;
+    xQueueSend(displayQueue, &idx, 0);
+  } else if (lastChunk) {
+    slot->nackRequested = true; // Letzter Chunk da, aber Lücken vorhanden
+  }
+}
+
+// Sendet NACK/ACK an die Sender: nach dem letzten Chunk, nach Bildabschluss oder nach Funkstille
+static void serviceNack() {
+  esp_now_nack_t msg;
+  for (uint8_t i = 0; i < rxSlotsAllocated; ++i) {
+    RxSlot& slot = rxSlots[i];
+    if (slot.state != RxSlot::RECEIVING) continue;
+    bool due = slot.nackRequested;
+    if (!due && millis() - slot.lastActivity > NACK_SILENCE_MS &&
+        slot.nackAttempts < NACK_MAX_ATTEMPTS) {
+      ++slot.nackAttempts;
+      slot.lastActivity = millis();
+      due = true;
+    }
+    if (!due) continue;
+    slot.nackRequested = false;
+    sendNack(slot.mac, msg, slot.assembly.buildNack(msg));
+  }
+
+  if (ackRequested) {
+    ackRequested = false;
+    msg.magic = ESP_NOW_CTRL_MAGIC;
+    msg.type = ESP_NOW_CTRL_NACK;
+    msg.image_id = ackTarget.imageId;
+    msg.received_chunks = 0;
+    msg.range_count = 0;
+    sendNack(ackTarget.mac, msg, espNowNackSize(msg));
+  }
+}
+
+// Empfangs-Task: leert die Queue und kümmert sich um NACKs
+static void rxTask(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NACK_SILENCE_MS));
+    while (const auto* pkt = rxQueue.front()) {
+      handlePacket(pkt->mac, pkt->data, pkt->len, pkt->rssi);
+      rxQueue.pop();
+    }
+    serviceNack();
+  }
+}
+
+#if LINK_REPORT
+// Der ESP-NOW Callback liefert keine RSSI. Der Promiscuous-Callback sieht dasselbe
+// Frame (herstellerspezifisches Action-Frame mit Espressif-OUI) kurz vorher.
+static volatile int8_t lastRssi = 0;
+static uint8_t lastRssiMac[6];
+
+static void IRAM_ATTR onPromiscuous(void* buf, wifi_promiscuous_pkt_type_t type) {
+  if (type != WIFI_PKT_MGMT) return;
+  const wifi_promiscuous_pkt_t* pkt = (const wifi_promiscuous_pkt_t*)buf;
+  const uint8_t* frame = pkt->payload;
+  if (pkt->rx_ctrl.sig_len < 28) return;
+  if (frame[0] != 0xD0 || frame[24] != 127 || frame[25] != 0x18 || frame[26] != 0xFE || frame[27] != 0x34) return;
+  memcpy(lastRssiMac, frame + 10, 6); // Adresse 2 = Absender
+  lastRssi = pkt->rx_ctrl.rssi;
+}
+#endif
+
+// Callback-Funktion für den Empfang von ESP-NOW Daten (läuft im WiFi-Task, daher nur kopieren)
+void OnDataRecv(const uint8_t * mac, const uint8_t *incomingData, int len) {
+  int8_t rssi = 0;
+#if LINK_REPORT
+  if (memcmp(mac, lastRssiMac, 6) == 0) rssi = lastRssi;
+#endif
+  if (rxQueue.push(mac, incomingData, len, rssi)) {
+    xTaskNotifyGive(rxTaskHandle);
+  }
+}
+
+// Zeichnet Kopfzeile bzw. Fortschrittsbalken für das gerade empfangene Bild
+static uint32_t drawnImageId = 0;
+
+// Statuszeile unter dem angezeigten Bild, wenn eine Kamera ohne Bild meldet
+static void drawHeartbeat() {
+  RxHeartbeat hb;
+  portENTER_CRITICAL(&rxProgressMux);
+  hb = rxHeartbeat;
+  rxHeartbeat.pending = false;
+  portEXIT_CRITICAL(&rxProgressMux);
+  if (!hb.pending) return;
+
+  tft.setCursor(5, tft.height() - 28);
+  tft.setTextSize(1);
+  tft.setTextColor(TFT_CYAN, TFT_BLACK);
+  tft.printf("Kamera %02X%02X | unveraendert | VBat: %.2fV   ", hb.mac[4], hb.mac[5], hb.vbat_mV / 1000.0f);
+}
+
+// Wachzeit des vorigen Sendezyklus der Kamera, Phasen in ms
+static void drawWakeProfile(const WakeProfile& p) {
+  static_assert(WAKE_PHASE_COUNT == 7, "Profil-Ausgabe an die Phasen anpassen");
+  ECO_LOGI("Wachzeit-Profil: boot=%u vbat=%u cam=%u capture=%u link=%u upload=%u sleep=%u gesamt=%lu ms",
+           p.phase_ms[WAKE_BOOT], p.phase_ms[WAKE_VBAT], p.phase_ms[WAKE_CAMERA], p.phase_ms[WAKE_CAPTURE],
+           p.phase_ms[WAKE_LINK], p.phase_ms[WAKE_UPLOAD], p.phase_ms[WAKE_SLEEP], (unsigned long)p.totalMs());
+
+  tft.setCursor(5, tft.height() - 16);
+  tft.setTextSize(1);
+  tft.setTextColor(TFT_GREEN, TFT_BLACK);
+  tft.printf("Wach %lums:", (unsigned long)p.totalMs());
+  // Kurzform ohne Boot/Sleep, damit die Zeile auf 320 px passt
+  for (uint8_t i = WAKE_VBAT; i < WAKE_SLEEP; ++i) tft.printf(" %.3s %u", WAKE_PHASE_NAMES[i], p.phase_ms[i]);
+  tft.print("   ");
+}
+
+// Bildunterschrift: Kamera, Bild-ID und Batteriespannung
+static void drawImageCaption(const uint8_t* mac, uint32_t imageId, uint16_t vbat_mV) {
+  tft.setCursor(5, tft.height() - 40); // Unten auf dem Display
+  tft.setTextSize(1);
+  tft.setTextColor(TFT_YELLOW, TFT_BLACK);
+  tft.printf("Kamera %02X%02X | Bild ID: %u | VBat: %.2fV", mac[4], mac[5], imageId, vbat_mV / 1000.0f);
+}
+
+// ───────── Live-Modus ─────────
+// Bildrate aus den Anzeigezeitpunkten, Latenz von der Aufnahme bis zur Anzeige (je gleitend
+// gemittelt). Ausgelassen: Lücken in der Bildnummer, d.h. beim Sender verworfene oder nicht
+// vollständig empfangene Bilder.
+struct LiveStats {
+  uint8_t  mac[6];
+  uint32_t frames;
+  uint16_t lastSeq;
+  unsigned long lastShownMs;
+  float    fps;
+  float    latencyMs;
+  uint32_t skipped;
+  uint32_t staleDropped;   // nicht gezeichnet, da schon ein neueres Bild wartete
+  unsigned long lastLog;
+};
+static LiveStats liveStats = {};
+
+// Latenz = Alter beim Sendebeginn (vom Sender) + erstes Paket bis Anzeige (hier gemessen).
+// Nicht enthalten sind die Belichtung und die Funkzeit des ersten Pakets (~1 ms).
+static void drawLiveStats(const RxSlot& slot, unsigned long shownMs) {
+  LiveStats& st = liveStats;
+  float latency = slot.liveAgeMs + (shownMs - slot.firstPacketMs);
+  if (st.frames > 0 && memcmp(st.mac, slot.mac, 6) == 0) {
+    uint16_t gap = slot.liveSeq - st.lastSeq;
+    if (gap > 1 && gap < 0x8000) st.skipped += gap - 1;
+    unsigned long dt = shownMs - st.lastShownMs;
+    if (dt > 0) st.fps = st.fps > 0 ? 0.8f * st.fps + 200.0f / dt : 1000.0f / dt;
+    st.latencyMs = 0.8f * st.latencyMs + 0.2f * latency;
+  } else {
+    // Neuer Stream (andere Kamera oder erster Start)
+    st = {};
+    memcpy(st.mac, slot.mac, 6);
+    st.latencyMs = latency;
+    st.lastLog = shownMs;
+  }
+  st.lastSeq = slot.liveSeq;
+  st.lastShownMs = shownMs;
+  ++st.frames;
+
+  tft.setCursor(5, tft.height() - 12);
+  tft.setTextSize(1);
+  tft.setTextColor(TFT_YELLOW, TFT_BLACK);
+  tft.printf("LIVE %02X%02X | %.1f fps | Latenz %lu ms | ausgelassen %lu ", slot.mac[4], slot.mac[5], st.fps,
+             (unsigned long)st.latencyMs, (unsigned long)st.skipped);
+
+  if (shownMs - st.lastLog >= LIVE_LOG_MS) {
+    st.lastLog = shownMs;
+    ECO_LOGI("Live %02X:%02X: %.1f fps, Latenz %lu ms, %lu Bilder, %lu ausgelassen, %lu veraltet verworfen.",
+             slot.mac[4], slot.mac[5], st.fps, (unsigned long)st.latencyMs, (unsigned long)st.frames,
+             (unsigned long)st.skipped, (unsigned long)st.staleDropped);
+  }
+}
+
+// Minimale Pufferung: ein fertiges, noch nicht gezeichnetes Live-Bild wird übersprungen,
+// sobald dahinter schon ein neueres Bild wartet
+static bool newerImageWaiting() {
+#if PROGRESSIVE_DISPLAY
+  if (uxQueueMessagesWaiting(streamQueue) > 0) return true;
+#endif
+  return uxQueueMessagesWaiting(displayQueue) > 0;
+}
+
+static void drawProgress() {
+  static uint16_t drawnChunks = 0;
+  static unsigned long lastDraw = 0;
+  static uint32_t lastDropped = 0;
+
+  if (millis() - lastDraw < 1000 / UI_FPS) return;
+  lastDraw = millis();
+
+  RxProgress p;
+  portENTER_CRITICAL(&rxProgressMux);
+  p = rxProgress;
+  rxProgress.allocError = false;
+  portEXIT_CRITICAL(&rxProgressMux);
+
+  if (rxQueue.dropped() != lastDropped) {
+    lastDropped = rxQueue.dropped();
+    ECO_LOGW("Empfangs-Queue: %u Pakete verworfen, max. Fuellstand %u/%u.",
+                  lastDropped, rxQueue.highWater(), rxQueue.capacity());
+  }
+
+  if (p.allocError) {
+    tft.fillScreen(TFT_RED);
+    tft.setCursor(10, 10);
+    tft.setTextSize(2);
+    tft.setTextColor(TFT_WHITE);
+    tft.println("Speicherfehler!");
+    drawnImageId = 0;
+    return;
+  }
+  if (p.totalChunks == 0) return; // kein laufender Empfang
+  if (p.live) return;             // Live-Bilder ersetzen direkt das vorige
+#if PROGRESSIVE_DISPLAY
+  if (p.imageId == uiStreamedImageId) return; // Bild wird bereits progressiv gezeichnet
+#endif
+
+  if (p.imageId != drawnImageId) {
+    drawnImageId = p.imageId;
+    drawnChunks = 0;
     tft.fillScreen(TFT_BLACK);
     tft.setCursor(5, 10);
     tft.setTextSize(2);
     tft.setTextColor(TFT_GREEN, TFT_BLACK);
-    tft.printf("Empfange Bild ID %u\n", currentImageId);
-    tft.printf("Groesse: %u Bytes\n", imageBufferSize);
-    tft.printf("Chunks: %u\n", chunk.total_chunks);
+    tft.printf("Empfange Bild ID %u\n", p.imageId);
+    tft.printf("Kamera: %02X%02X\n", p.mac[4], p.mac[5]);
+    tft.printf("Groesse: %u Bytes\n", p.totalSize);
+    tft.printf("Chunks: %u\n", p.totalChunks);
+    tft.drawRect(5, 105, tft.width() - 10, 12, TFT_DARKGREY);
+  }
+  if (p.receivedChunks == drawnChunks) return;
+  drawnChunks = p.receivedChunks;
+
+  tft.fillRect(5, 80, tft.width() - 10, 20, TFT_BLACK); // Alten Fortschritt löschen
+  tft.setCursor(5, 82);
+  tft.setTextSize(2);
+  tft.setTextColor(TFT_CYAN, TFT_BLACK);
+  tft.printf("Chunk %u/%u", p.receivedChunks, p.totalChunks);
+  int32_t barWidth = (int32_t)(tft.width() - 12) * p.receivedChunks / p.totalChunks;
+  tft.fillRect(6, 106, barWidth, 10, TFT_CYAN);
+}
+
+// Löscht nur den Rand um ein zentriertes Bild; Live-Bilder überschreiben das vorige
+// so ohne schwarzes Aufblitzen
+static void clearAround(int16_t x, int16_t y, uint16_t w, uint16_t h) {
+  int16_t right = x + w, bottom = y + h;
+  if (y > 0) tft.fillRect(0, 0, tft.width(), y, TFT_BLACK);
+  if (bottom < tft.height()) tft.fillRect(0, bottom, tft.width(), tft.height() - bottom, TFT_BLACK);
+  if (x > 0) tft.fillRect(0, y, x, h, TFT_BLACK);
+  if (right < tft.width()) tft.fillRect(right, y, tft.width() - right, h, TFT_BLACK);
+}
 
-  } else if (!imageReceiveInProgress || chunk.image_id != currentImageId) {
-    Serial.printf("Verwerfe Chunk für Bild ID %u, erwarte ID %u oder keinen Empfang.\n", chunk.image_id, currentImageId);
-    return; // Chunk gehört nicht zum aktuellen Bild oder kein Empfang aktiv
+// Liest die Größe aus dem SOF-Marker, skaliert passend und zeichnet das Bild zentriert.
+// clearBorder: vorher den Rand um das Bild löschen (Live-Bilder, ohne fillScreen)
+static JRESULT drawImage(const uint8_t* buf, uint32_t len, bool clearBorder = false) {
+  uint16_t w = 0, h = 0;
+  int16_t x = 0, y = 0;
+  uint8_t scale = 1;
+  if (jpegSize(buf, len, w, h)) {
+    scale = fitScale(w, h);
+    centerImage(w, h, scale, x, y);
   }
+  if (clearBorder) clearAround(x, y, (w + scale - 1) / scale, (h + scale - 1) / scale);
+  TJpgDec.setJpgScale(scale);
+  decodeBegin(x, (w + scale - 1) / scale);
+  JRESULT result = TJpgDec.drawJpg(x, y, buf, len);
+  decodeEnd();
+  return result;
+}
+
+#if PROGRESSIVE_DISPLAY
+// ───────── Progressive Anzeige während des Empfangs ─────────
+// Der in TJpg_Decoder enthaltene tjpgd-Decoder wird direkt angesteuert: Die Eingabefunktion
+// liest aus dem Slot-Puffer und blockiert, bis die benötigten Chunks eingetroffen sind.
+struct StreamSource {
+  RxSlot*  slot;
+  uint32_t imageId;
+  uint16_t chunkSize;
+  uint32_t pos;
+  bool     swapBytes; // Byte-Tausch selbst erledigen, falls tjpgd ihn nicht unterstützt
+  int16_t  x0, y0;    // Position des zentrierten Bildes
+};
+
+// Wartet, bis alle Chunks für den Bereich [pos, end) vorhanden sind
+static bool waitForBytes(const StreamSource& src, uint32_t end) {
+  const ImageAssembly& a = src.slot->assembly;
+  uint16_t last = (end - 1) / src.chunkSize;
+  unsigned long t0 = millis();
+  for (uint16_t i = src.pos / src.chunkSize; i <= last; ) {
+    if (src.slot->state == RxSlot::FREE || a.imageId() != src.imageId) return false;
+    if (a.hasChunk(i)) {
+      ++i;
+      t0 = millis();
+      continue;
+    }
+    if (millis() - t0 > STREAM_WAIT_MS) return false;
+    // Live: auf einen fehlenden Chunk nicht warten, wenn schon das nächste Bild kommt
+    if (src.slot->live && uxQueueMessagesWaiting(streamQueue) > 0) return false;
+    vTaskDelay(pdMS_TO_TICKS(2));
+  }
+  return true;
+}
+
+// Eingabefunktion für tjpgd; Typen werden aus der jd_prepare-Signatur der Bibliotheksversion abgeleitet
+template <typename N>
+static N streamInput(JDEC* jd, uint8_t* buf, N len) {
+  StreamSource& src = *static_cast<StreamSource*>(jd->device);
+  uint32_t total = src.slot->assembly.totalSize();
+  if (src.pos >= total) return 0;
+  if (len > total - src.pos) len = total - src.pos;
+  if (!waitForBytes(src, src.pos + len)) return 0; // Chunk fehlt: tjpgd bricht mit JDR_INP ab
+  if (buf) memcpy(buf, src.slot->buffer + src.pos, len);
+  src.pos += len;
+  return len;
+}
+
+template <typename R>
+static R streamOutput(JDEC* jd, void* bitmap, JRECT* rect) {
+  const StreamSource& src = *static_cast<StreamSource*>(jd->device);
+  uint16_t w = rect->right + 1 - rect->left;
+  uint16_t h = rect->bottom + 1 - rect->top;
+  uint16_t* px = (uint16_t*)bitmap;
+  if (src.swapBytes) {
+    for (uint32_t i = 0; i < (uint32_t)w * h; ++i) px[i] = (px[i] >> 8) | (px[i] << 8);
+  }
+  return tft_output(src.x0 + rect->left, src.y0 + rect->top, w, h, px) ? 1 : 0;
+}
+
+// Setzt den Byte-Tausch im Decoder, sofern die tjpgd-Version das Feld 'swap' kennt
+template <typename J>
+static auto setDecoderSwap(J& jd, bool swap, int) -> decltype(jd.swap = swap, true) {
+  jd.swap = swap;
+  return true;
+}
+template <typename J>
+static bool setDecoderSwap(J&, bool, long) { return false; }
 
-  // Daten in den Puffer kopieren
-  uint32_t offset = chunk.chunk_index * ESP_NOW_MAX_DATA_PER_CHUNK;
-  if (offset + chunk.data_len <= imageBufferSize) {
-    memcpy(imageDataBuffer + offset, chunk.data, chunk.data_len);
-    receivedImageBytes += chunk.data_len;
+// Zeichnet das Bild, während es noch empfangen wird; false bei fehlenden Chunks oder Fehler
+static bool streamDecode(RxSlot& slot, uint32_t imageId) {
+  static uint8_t workspace[STREAM_WORKSPACE_SIZE];
+  StreamSource src = { &slot, imageId, slot.assembly.chunkSize(), 0, false, 0, 0 };
+  JDEC jd;
+
+  slot.streaming = true;
+  uiStreamedImageId = imageId;
+  unsigned long t0 = millis();
+  JRESULT result = jd_prepare(&jd, streamInput, workspace, sizeof(workspace), &src);
+  if (result == JDR_OK) {
+    src.swapBytes = !setDecoderSwap(jd, true, 0);
+    uint8_t scale = fitScale(jd.width, jd.height);
+    centerImage(jd.width, jd.height, scale, src.x0, src.y0);
+    if (slot.live) {
+      clearAround(src.x0, src.y0, (jd.width + scale - 1) / scale, (jd.height + scale - 1) / scale);
+    } else {
+      tft.fillScreen(TFT_BLACK);
+    }
+    decodeBegin(src.x0, (jd.width + scale - 1) / scale);
+    result = jd_decomp(&jd, streamOutput, __builtin_ctz(scale)); // tjpgd erwartet 0..3 (1/1..1/8)
+    decodeEnd();
+  }
+  slot.streaming = false;
+
+  // JDR_INTR: tft_output hat am unteren Bildschirmrand abgebrochen, Rest wird nicht benötigt
+  bool ok = result == JDR_OK || result == JDR_INTR;
+  if (ok) {
+    slot.streamed = true;
+    slot.shownMs = millis();
+    if (!slot.live) ECO_LOGI("Bild ID %u progressiv angezeigt (%lu ms).", imageId, slot.shownMs - t0);
   } else {
-    Serial.println("Fehler: Chunk-Daten würden Puffer überlaufen.");
-    free(imageDataBuffer);
-    imageDataBuffer = nullptr;
-    imageReceiveInProgress = false;
+    if (!slot.live) {
+      ECO_LOGW("Progressive Anzeige von Bild ID %u abgebrochen (Code %d), warte auf vollstaendiges Bild.",
+                    imageId, result);
+    }
+    uiStreamedImageId = 0;
+    drawnImageId = 0; // Fortschrittsanzeige neu aufbauen
+  }
+  return ok;
+}
+#endif
+
+#if IMAGE_HISTORY
+// ───────── Bildverlauf ─────────
+// Jedes angezeigte Bild bleibt als JPEG erhalten (PSRAM, ohne PSRAM bzw. mit HISTORY_FLASH
+// im LittleFS) und bekommt beim Eintragen ein Vorschaubild in RGB565. Dafür dekodiert
+// tjpgd mit 1/8-Skalierung nur die DC-Koeffizienten. Die Übersicht zeigt nur diese
+// Vorschaubilder, Blättern darin braucht keine JPEG-Dekodierung. Überschreiten Anzahl
+// oder Speicherbedarf die Grenzen, wird das am längsten nicht angesehene Bild verdrängt.
+#define HIST_THUMB_PIXELS (HIST_THUMB_W * HIST_THUMB_H)
+#define HIST_THUMB_BYTES (HIST_THUMB_PIXELS * 2)
+#define HIST_DIR "/hist"
+#define HIST_MAGIC 0x31485345 // "ESH1"
+
+// Kopf der Vorschau-Datei (<seq>.thb), danach HIST_THUMB_BYTES Pixel. Die Datei wird
+// nach dem JPEG (<seq>.jpg) geschrieben und markiert einen vollständigen Eintrag.
+struct HistoryFileHeader {
+  uint32_t magic;
+  uint32_t imageId;
+  uint32_t jpegLen;
+  uint16_t width, height;
+  uint16_t vbat_mV;
+  uint8_t  mac[6];
+};
+
+struct HistoryEntry {
+  bool      used;
+  uint32_t  seq;        // Eintragsreihenfolge, zugleich Dateiname
+  uint32_t  lastUse;    // Stand von historyClock beim letzten Eintragen/Ansehen (LRU)
+  uint32_t  imageId;
+  uint32_t  jpegLen;
+  uint16_t  width, height;
+  uint16_t  vbat_mV;
+  uint8_t   mac[6];
+  uint8_t*  jpeg;       // PSRAM, nullptr wenn im LittleFS
+  uint16_t* thumb;      // PSRAM, nullptr wenn nur im LittleFS
+};
+
+static HistoryEntry history[HISTORY_MAX_IMAGES];
+static uint32_t historySeq = 0;
+static uint32_t historyClock = 0;
+static uint32_t historyBytes = 0;
+static bool historyFlash = false;
+static bool historyReady = false;
+static uint16_t historyScratch[HIST_THUMB_PIXELS]; // Vorschaubild beim Eintragen bzw. aus dem LittleFS
+
+static void historyPath(char* out, size_t size, uint32_t seq, const char* ext) {
+  snprintf(out, size, HIST_DIR "/%lu.%s", (unsigned long)seq, ext);
+}
+
+static void historyRemove(HistoryEntry& e) {
+  if (historyFlash) {
+    char path[32];
+    historyPath(path, sizeof(path), e.seq, "thb");
+    LittleFS.remove(path);
+    historyPath(path, sizeof(path), e.seq, "jpg");
+    LittleFS.remove(path);
+  }
+  free(e.jpeg);
+  free(e.thumb);
+  historyBytes -= e.jpegLen + HIST_THUMB_BYTES;
+  e = HistoryEntry();
+}
+
+// Verdrängt Einträge (LRU), bis extraEntries weitere mit extraBytes Platz haben
+static void historyTrim(uint8_t extraEntries, uint32_t extraBytes) {
+  for (;;) {
+    uint8_t count = 0;
+    HistoryEntry* lru = nullptr;
+    for (HistoryEntry& e : history) {
+      if (!e.used) continue;
+      ++count;
+      if (lru == nullptr || e.lastUse < lru->lastUse) lru = &e;
+    }
+    if (lru == nullptr ||
+        (count + extraEntries <= HISTORY_MAX_IMAGES && historyBytes + extraBytes <= HISTORY_BUDGET_BYTES)) {
+      return;
+    }
+    ECO_LOGD("Verlauf: verdraenge Bild ID %u.", lru->imageId);
+    historyRemove(*lru);
+  }
+}
+
+// Indizes der belegten Einträge, neuestes zuerst; liefert die Anzahl
+static uint8_t historyOrder(uint8_t* order) {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < HISTORY_MAX_IMAGES; ++i) {
+    if (!history[i].used) continue;
+    uint8_t j = n++;
+    for (; j > 0 && history[order[j - 1]].seq < history[i].seq; --j) order[j] = order[j - 1];
+    order[j] = i;
+  }
+  return n;
+}
+
+// Ziel für die 1/8-Blöcke des Decoders beim Erzeugen eines Vorschaubildes
+static uint16_t* thumbTarget = nullptr;
+static uint16_t thumbSrcW = 1, thumbSrcH = 1;
+
+// Übernimmt aus jedem Block die Pixel, die beim Abtasten auf HIST_THUMB_W x HIST_THUMB_H
+// hineinfallen (Vorschau-Pixel t stammt von Quell-Pixel t * src / thumb)
+static bool thumbOutput(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap) {
+  uint32_t ty0 = ((uint32_t)y * HIST_THUMB_H + thumbSrcH - 1) / thumbSrcH;
+  uint32_t ty1 = min<uint32_t>(((uint32_t)(y + h) * HIST_THUMB_H + thumbSrcH - 1) / thumbSrcH, HIST_THUMB_H);
+  uint32_t tx0 = ((uint32_t)x * HIST_THUMB_W + thumbSrcW - 1) / thumbSrcW;
+  uint32_t tx1 = min<uint32_t>(((uint32_t)(x + w) * HIST_THUMB_W + thumbSrcW - 1) / thumbSrcW, HIST_THUMB_W);
+  for (uint32_t ty = ty0; ty < ty1; ++ty) {
+    const uint16_t* row = bitmap + (ty * thumbSrcH / HIST_THUMB_H - y) * w;
+    for (uint32_t tx = tx0; tx < tx1; ++tx) {
+      thumbTarget[ty * HIST_THUMB_W + tx] = row[tx * thumbSrcW / HIST_THUMB_W - x];
+    }
+  }
+  return true;
+}
+
+static bool historyMakeThumb(const uint8_t* jpeg, uint32_t len, uint16_t w, uint16_t h, uint16_t* out) {
+  thumbTarget = out;
+  thumbSrcW = max<uint16_t>(w / 8, 1);
+  thumbSrcH = max<uint16_t>(h / 8, 1);
+  memset(out, 0, HIST_THUMB_BYTES);
+  TJpgDec.setCallback(thumbOutput);
+  TJpgDec.setJpgScale(8);
+  JRESULT result = TJpgDec.drawJpg(0, 0, jpeg, len);
+  TJpgDec.setCallback(tft_output);
+  return result == JDR_OK;
+}
+
+static bool historyWriteFiles(const HistoryEntry& e, const uint8_t* jpeg, const uint16_t* thumb) {
+  char path[32];
+  historyPath(path, sizeof(path), e.seq, "jpg");
+  File f = LittleFS.open(path, FILE_WRITE);
+  bool ok = f && f.write(jpeg, e.jpegLen) == e.jpegLen;
+  if (f) f.close();
+  if (ok) {
+    HistoryFileHeader hdr = { HIST_MAGIC, e.imageId, e.jpegLen, e.width, e.height, e.vbat_mV, {} };
+    memcpy(hdr.mac, e.mac, 6);
+    historyPath(path, sizeof(path), e.seq, "thb");
+    f = LittleFS.open(path, FILE_WRITE);
+    ok = f && f.write((const uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) &&
+         f.write((const uint8_t*)thumb, HIST_THUMB_BYTES) == HIST_THUMB_BYTES;
+    if (f) f.close();
+  }
+  if (!ok) {
+    LittleFS.remove(path);
+    historyPath(path, sizeof(path), e.seq, "jpg");
+    LittleFS.remove(path);
+  }
+  return ok;
+}
+
+// Vorschaubild eines Eintrags; aus dem LittleFS in historyScratch gelesen, falls nicht im PSRAM
+static const uint16_t* historyThumb(const HistoryEntry& e) {
+  if (e.thumb != nullptr) return e.thumb;
+  char path[32];
+  historyPath(path, sizeof(path), e.seq, "thb");
+  File f = LittleFS.open(path, FILE_READ);
+  bool ok = f && f.seek(sizeof(HistoryFileHeader)) &&
+            f.read((uint8_t*)historyScratch, HIST_THUMB_BYTES) == HIST_THUMB_BYTES;
+  if (f) f.close();
+  return ok ? historyScratch : nullptr;
+}
+
+// Trägt ein fertig empfangenes Bild ein (UI-Task, Slot ist noch belegt)
+static void historyAdd(const RxSlot& slot) {
+  if (!historyReady) return;
+  uint32_t len = slot.assembly.totalSize();
+  uint32_t bytes = len + HIST_THUMB_BYTES;
+  uint16_t w = 0, h = 0;
+  unsigned long t0 = millis();
+  if (bytes > HISTORY_BUDGET_BYTES || !jpegSize(slot.buffer, len, w, h) ||
+      !historyMakeThumb(slot.buffer, len, w, h, historyScratch)) {
+    ECO_LOGD("Verlauf: Bild ID %u nicht eingetragen.", slot.assembly.imageId());
     return;
   }
-  
-  lastVBat_mV = (chunk.vbat_mv_high << 8) | chunk.vbat_mv_low;
+  unsigned long thumbMs = millis() - t0;
+  historyTrim(1, bytes);
 
-  // Fortschritt anzeigen (optional, kann bei vielen Chunks flackern)
-  tft.fillRect(5, 80, tft.width() - 10, 20, TFT_BLACK); // Alten Fortschritt löschen
-  tft.setCursor(5, 80);
-  tft.setTextSize(2);
-  tft.setTextColor(TFT_CYAN, TFT_BLACK);
-  tft.printf("Chunk %u/%u", chunk.chunk_index + 1, chunk.total_chunks);
-  Serial.printf("Chunk %u/%u (ID %u) empfangen. %u/%u Bytes.\n", chunk.chunk_index + 1, chunk.total_chunks, chunk.image_id, receivedImageBytes, imageBufferSize);
+  HistoryEntry* e = nullptr;
+  for (HistoryEntry& entry : history) {
+    if (!entry.used) { e = &entry; break; }
+  }
+  if (e == nullptr) return;
+  e->seq = ++historySeq;
+  e->lastUse = ++historyClock;
+  e->imageId = slot.assembly.imageId();
+  e->jpegLen = len;
+  e->width = w;
+  e->height = h;
+  e->vbat_mV = slot.vbat_mV;
+  memcpy(e->mac, slot.mac, 6);
+  e->jpeg = nullptr;
+  e->thumb = psramFound() ? (uint16_t*)ps_malloc(HIST_THUMB_BYTES) : nullptr;
+  if (e->thumb != nullptr) memcpy(e->thumb, historyScratch, HIST_THUMB_BYTES);
 
-  // Prüfen, ob alle Chunks empfangen wurden
-  if (receivedImageBytes >= imageBufferSize && chunk.chunk_index == chunk.total_chunks - 1) {
-    Serial.println("Bild vollstaendig empfangen.");
-    newImageReadyToDisplay = true;
-    imageReceiveInProgress = false; // Empfang für dieses Bild abgeschlossen
+  bool ok;
+  if (historyFlash) {
+    ok = historyWriteFiles(*e, slot.buffer, historyScratch);
+  } else {
+    e->jpeg = (uint8_t*)ps_malloc(len);
+    ok = e->jpeg != nullptr && e->thumb != nullptr;
+    if (ok) memcpy(e->jpeg, slot.buffer, len);
   }
+  if (!ok) {
+    free(e->jpeg);
+    free(e->thumb);
+    *e = HistoryEntry();
+    ECO_LOGE("Verlauf: Speicherfehler bei Bild ID %u.", slot.assembly.imageId());
+    return;
+  }
+  e->used = true;
+  historyBytes += bytes;
+  ECO_LOGI("Verlauf: Bild ID %u eingetragen (Vorschau %lu ms, gesamt %lu ms, %u/%u Bytes).",
+                e->imageId, thumbMs, millis() - t0, historyBytes, HISTORY_BUDGET_BYTES);
 }
 
+// Lädt die Einträge aus dem LittleFS (neueste zuerst, falls es mehr als HISTORY_MAX_IMAGES sind)
+static void historyLoad() {
+  File dir = LittleFS.open(HIST_DIR);
+  if (!dir || !dir.isDirectory()) {
+    LittleFS.mkdir(HIST_DIR);
+    return;
+  }
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    const char* name = strrchr(f.name(), '/');
+    name = name ? name + 1 : f.name();
+    const char* ext = strchr(name, '.');
+    if (ext == nullptr || strcmp(ext, ".thb") != 0) continue;
+    uint32_t seq = strtoul(name, nullptr, 10);
+
+    HistoryFileHeader hdr;
+    char path[32];
+    historyPath(path, sizeof(path), seq, "jpg");
+    bool valid = f.size() == sizeof(hdr) + HIST_THUMB_BYTES &&
+                 f.read((uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == HIST_MAGIC;
+    if (valid) {
+      File jpg = LittleFS.open(path, FILE_READ);
+      valid = jpg && jpg.size() == hdr.jpegLen;
+      if (jpg) jpg.close();
+    }
+    if (!valid) continue; // unvollständig, wird unten entfernt
+
+    HistoryEntry* slot = nullptr;
+    for (HistoryEntry& e : history) {
+      if (!e.used) { slot = &e; break; }
+      if (slot == nullptr || e.seq < slot->seq) slot = &e;
+    }
+    if (slot->used) {
+      if (slot->seq > seq) continue;
+      historyRemove(*slot);
+    }
+    HistoryEntry& e = *slot;
+    e.used = true;
+    e.seq = e.lastUse = seq;
+    e.imageId = hdr.imageId;
+    e.jpegLen = hdr.jpegLen;
+    e.width = hdr.width;
+    e.height = hdr.height;
+    e.vbat_mV = hdr.vbat_mV;
+    memcpy(e.mac, hdr.mac, 6);
+    e.jpeg = nullptr;
+    e.thumb = psramFound() ? (uint16_t*)ps_malloc(HIST_THUMB_BYTES) : nullptr;
+    if (e.thumb != nullptr && f.read((uint8_t*)e.thumb, HIST_THUMB_BYTES) != HIST_THUMB_BYTES) {
+      free(e.thumb);
+      e.thumb = nullptr;
+    }
+    historyBytes += e.jpegLen + HIST_THUMB_BYTES;
+    historySeq = max(historySeq, seq);
+  }
+  dir.close();
+  historyClock = historySeq;
+
+  // Dateien ohne gültigen Eintrag (abgebrochenes Schreiben, verdrängt) entfernen
+  uint32_t orphans[8];
+  uint8_t orphanCount = 0;
+  dir = LittleFS.open(HIST_DIR);
+  for (File f = dir.openNextFile(); f && orphanCount < 8; f = dir.openNextFile()) {
+    const char* name = strrchr(f.name(), '/');
+    uint32_t seq = strtoul(name ? name + 1 : f.name(), nullptr, 10);
+    bool known = false;
+    for (const HistoryEntry& e : history) known |= e.used && e.seq == seq;
+    if (!known) orphans[orphanCount++] = seq;
+  }
+  dir.close();
+  for (uint8_t i = 0; i < orphanCount; ++i) {
+    char path[32];
+    historyPath(path, sizeof(path), orphans[i], "thb");
+    LittleFS.remove(path);
+    historyPath(path, sizeof(path), orphans[i], "jpg");
+    LittleFS.remove(path);
+  }
+  historyTrim(0, 0); // Budget kann seit dem letzten Start verkleinert worden sein
+}
+
+static void historyBegin() {
+  historyFlash = HISTORY_FLASH || !psramFound();
+  if (historyFlash) {
+    if (!LittleFS.begin(true)) {
+      ECO_LOGE("Verlauf: LittleFS nicht verfuegbar, Verlauf deaktiviert.");
+      return;
+    }
+    historyLoad();
+  }
+  historyReady = true;
+  uint8_t order[HISTORY_MAX_IMAGES];
+  ECO_LOGI("Verlauf: %u Bilder, %u/%u Bytes (%s).", historyOrder(order), historyBytes,
+                HISTORY_BUDGET_BYTES, historyFlash ? "LittleFS" : "PSRAM");
+}
+
+// ───────── Verlauf durchblättern (BOOT-Taste) ─────────
+// Live: kurz/lang → Übersicht. Übersicht: kurz → nächstes (älteres) Bild, lang → Bild
+// öffnen. Bild: kurz → zurück zur Übersicht, lang → Live-Anzeige.
+enum ViewMode : uint8_t { VIEW_LIVE, VIEW_GRID, VIEW_IMAGE };
+static ViewMode viewMode = VIEW_LIVE;
+static uint32_t browseSeq = 0;          // ausgewählter Eintrag (seq), bleibt bei neuen Bildern erhalten
+static unsigned long browseLastInput = 0;
+
+// Kurzer Druck = 1 beim Loslassen, langer Druck = 2 schon während des Haltens, sonst 0
+static uint8_t pollBrowseButton() {
+  static bool down = false, longSent = false;
+  static unsigned long t0 = 0;
+  bool pressed = digitalRead(BROWSE_BUTTON_PIN) == LOW;
+  if (pressed && !down) {
+    down = true;
+    longSent = false;
+    t0 = millis();
+  } else if (pressed && !longSent && millis() - t0 >= BROWSE_LONG_PRESS_MS) {
+    longSent = true;
+    return 2;
+  } else if (!pressed && down) {
+    down = false;
+    if (!longSent && millis() - t0 >= 30) return 1; // kürzer: Prellen
+  }
+  return 0;
+}
+
+static uint8_t gridColumns() {
+  return tft.width() / HIST_THUMB_W;
+}
+
+static void drawGridTile(uint8_t pos, const HistoryEntry& e, bool selected) {
+  int16_t x = (pos % gridColumns()) * HIST_THUMB_W;
+  int16_t y = (pos / gridColumns()) * HIST_THUMB_H;
+  const uint16_t* px = historyThumb(e);
+  if (px != nullptr) {
+    tft.pushImage(x, y, HIST_THUMB_W, HIST_THUMB_H, (uint16_t*)px);
+  } else {
+    tft.fillRect(x, y, HIST_THUMB_W, HIST_THUMB_H, TFT_DARKGREY);
+  }
+  if (selected) {
+    tft.drawRect(x, y, HIST_THUMB_W, HIST_THUMB_H, TFT_YELLOW);
+    tft.drawRect(x + 1, y + 1, HIST_THUMB_W - 2, HIST_THUMB_H - 2, TFT_YELLOW);
+  }
+}
+
+static void drawGridInfo(const HistoryEntry& e, uint8_t pos, uint8_t count) {
+  uint8_t rows = (HISTORY_MAX_IMAGES + gridColumns() - 1) / gridColumns();
+  int16_t y = rows * HIST_THUMB_H + 4;
+  tft.fillRect(0, y, tft.width(), tft.height() - y, TFT_BLACK);
+  tft.setTextSize(1);
+  tft.setTextColor(TFT_YELLOW, TFT_BLACK);
+  tft.setCursor(5, y);
+  tft.printf("Verlauf %u/%u | Kamera %02X%02X | Bild ID: %u", pos + 1, count, e.mac[4], e.mac[5], e.imageId);
+  tft.setCursor(5, y + 12);
+  tft.printf("%ux%u | %u Bytes | VBat: %.2fV", e.width, e.height, e.jpegLen, e.vbat_mV / 1000.0f);
+  tft.setCursor(5, y + 30);
+  tft.setTextColor(TFT_DARKGREY, TFT_BLACK);
+  tft.print("BOOT kurz: weiter | lang: oeffnen");
+}
+
+// Position des ausgewählten Eintrags in order (0, falls er verdrängt wurde)
+static uint8_t browsePos(const uint8_t* order, uint8_t count) {
+  for (uint8_t i = 0; i < count; ++i) {
+    if (history[order[i]].seq == browseSeq) return i;
+  }
+  browseSeq = count > 0 ? history[order[0]].seq : 0;
+  return 0;
+}
+
+static void drawHistoryGrid() {
+  uint8_t order[HISTORY_MAX_IMAGES];
+  uint8_t count = historyOrder(order);
+  uint8_t sel = browsePos(order, count);
+  unsigned long t0 = millis();
+  tft.fillScreen(TFT_BLACK);
+  for (uint8_t i = 0; i < count; ++i) drawGridTile(i, history[order[i]], i == sel);
+  if (count > 0) drawGridInfo(history[order[sel]], sel, count);
+  ECO_LOGI("Verlauf: Uebersicht mit %u Bildern in %lu ms.", count, millis() - t0);
+}
+
+// Öffnet ein Bild des Verlaufs; JPEG aus dem PSRAM oder direkt aus dem LittleFS
+static void historyShow(HistoryEntry& e) {
+  e.lastUse = ++historyClock;
+  uint8_t scale = fitScale(e.width, e.height);
+  int16_t x, y;
+  centerImage(e.width, e.height, scale, x, y);
+  unsigned long t0 = millis();
+  tft.fillScreen(TFT_BLACK);
+  TJpgDec.setJpgScale(scale);
+  decodeBegin(x, (e.width + scale - 1) / scale);
+  JRESULT result;
+  if (e.jpeg != nullptr) {
+    result = TJpgDec.drawJpg(x, y, e.jpeg, e.jpegLen);
+  } else {
+    char path[32];
+    historyPath(path, sizeof(path), e.seq, "jpg");
+    result = TJpgDec.drawFsJpg(x, y, path, LittleFS);
+  }
+  decodeEnd();
+  ECO_LOGI("Verlauf: Bild ID %u angezeigt (Code %d, %lu ms).", e.imageId, result, millis() - t0);
+  drawImageCaption(e.mac, e.imageId, e.vbat_mV);
+}
+
+static void browseExit() {
+  viewMode = VIEW_LIVE;
+  uint8_t order[HISTORY_MAX_IMAGES];
+  if (historyOrder(order) > 0) {
+    historyShow(history[order[0]]); // neuestes Bild wie vor dem Blättern
+  } else {
+    tft.fillScreen(TFT_BLACK);
+  }
+}
+
+static void browseInput(uint8_t press) {
+  uint8_t order[HISTORY_MAX_IMAGES];
+  uint8_t count = historyOrder(order);
+  if (count == 0) return;
+  browseLastInput = millis();
+  uint8_t sel = browsePos(order, count);
+  switch (viewMode) {
+    case VIEW_LIVE:
+      viewMode = VIEW_GRID;
+      browseSeq = history[order[0]].seq;
+      drawHistoryGrid();
+      break;
+    case VIEW_GRID:
+      if (press == 1) {
+        // Nur Auswahlrahmen und Infozeile neu zeichnen
+        uint8_t next = (sel + 1) % count;
+        drawGridTile(sel, history[order[sel]], false);
+        drawGridTile(next, history[order[next]], true);
+        drawGridInfo(history[order[next]], next, count);
+        browseSeq = history[order[next]].seq;
+      } else {
+        viewMode = VIEW_IMAGE;
+        historyShow(history[order[sel]]);
+      }
+      break;
+    case VIEW_IMAGE:
+      if (press == 1) {
+        viewMode = VIEW_GRID;
+        drawHistoryGrid();
+      } else {
+        browseExit();
+      }
+      break;
+  }
+}
+#endif
+
+#if DECODE_BENCHMARK
+// ───────── Dekodier-Benchmark ─────────
+// Dekodiert alle JPEGs aus /bench (LittleFS, per "pio run -t uploadfs" aus data/bench)
+// je BENCH_ITERATIONS mal mit pushImage und mit DMA-Pipeline und gibt ms/Bild und fps aus.
+#define BENCH_ITERATIONS 10
+
+static float benchDecode(const uint8_t* buf, uint32_t len, bool pipeline) {
+#if DMA_PIPELINE
+  bool saved = dmaPipelineEnabled;
+  dmaPipelineEnabled = pipeline && saved;
+#endif
+  unsigned long t0 = micros();
+  for (uint8_t i = 0; i < BENCH_ITERATIONS; ++i) drawImage(buf, len);
+  float ms = (micros() - t0) / 1000.0f / BENCH_ITERATIONS;
+#if DMA_PIPELINE
+  dmaPipelineEnabled = saved;
+#endif
+  return ms;
+}
+
+static void runDecodeBenchmark() {
+  if (!LittleFS.begin()) {
+    ECO_LOGW("[Bench] LittleFS nicht verfuegbar.");
+    return;
+  }
+  File dir = LittleFS.open("/bench");
+  if (!dir || !dir.isDirectory()) {
+    ECO_LOGW("[Bench] Verzeichnis /bench fehlt.");
+    return;
+  }
+  RxSlot& slot = rxSlots[0]; // Puffer des ersten Slots, Empfang ist noch nicht gestartet
+  float sumSync = 0, sumDma = 0;
+  uint8_t count = 0;
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    if (f.isDirectory() || f.size() > slot.capacity) continue;
+    uint32_t len = f.read(slot.buffer, f.size());
+    uint16_t w = 0, h = 0;
+    jpegSize(slot.buffer, len, w, h);
+    float msSync = benchDecode(slot.buffer, len, false);
+    float msDma = benchDecode(slot.buffer, len, true);
+    ECO_LOGI("[Bench] %s %ux%u (%u Bytes, 1/%u): pushImage %.1f ms (%.1f fps) | DMA %.1f ms (%.1f fps) | x%.2f",
+                  f.name(), w, h, len, fitScale(w, h), msSync, 1000.0f / msSync, msDma, 1000.0f / msDma, msSync / msDma);
+    sumSync += msSync;
+    sumDma += msDma;
+    ++count;
+  }
+  if (count > 0) {
+    ECO_LOGI("[Bench] Mittel über %u Bilder: pushImage %.1f ms, DMA %.1f ms, x%.2f",
+                  count, sumSync / count, sumDma / count, sumSync / sumDma);
+  }
+  tft.fillScreen(TFT_BLACK);
+}
+#endif
+
 void setup() {
   Serial.begin(115200);
-  Serial.println("ESP-NOW Empfaenger gestartet.");
+  ECO_LOGI("ESP-NOW Empfaenger gestartet.");
 
   // TFT initialisieren
   tft.begin();
@@ -150,74 +1483,134 @@ void setup() {
   #endif
 
   // TJpg_Decoder konfigurieren
-  TJpgDec.setJpgScale(1);      // Keine Skalierung
+  TJpgDec.setJpgScale(1);      // Wird pro Bild passend zur Displaygröße gesetzt
   TJpgDec.setSwapBytes(true);  // Byte-Reihenfolge für Farben korrigieren (oft nötig)
   TJpgDec.setCallback(tft_output);
 
+  // Bildpuffer und Anzeige-Queue einmalig anlegen, danach kein malloc/free pro Bild
+  allocateSlots();
+  displayQueue = xQueueCreate(RX_SLOT_COUNT, sizeof(uint8_t));
+#if PROGRESSIVE_DISPLAY
+  streamQueue = xQueueCreate(RX_SLOT_COUNT, sizeof(StreamRequest));
+#endif
+
+#if DMA_PIPELINE
+  dmaPipelineEnabled = initBlitPipeline();
+  ECO_LOGI("DMA-Pipeline %s.", dmaPipelineEnabled ? "aktiv" : "nicht verfuegbar, nutze pushImage");
+#endif
+#if DECODE_BENCHMARK
+  runDecodeBenchmark();
+#endif
+#if IMAGE_HISTORY
+  pinMode(BROWSE_BUTTON_PIN, INPUT_PULLUP);
+  historyBegin();
+#endif
+
   // ESP-NOW initialisieren
   WiFi.mode(WIFI_STA);
   // Wichtig: Kanal für ESP-NOW festlegen. Muss mit Sender übereinstimmen.
-  // esp_wifi_set_promiscuous(true); // Nicht unbedingt nötig für reinen Empfang auf festem Kanal
   if (esp_wifi_set_channel(ESP_NOW_RECEIVER_CHANNEL, WIFI_SECOND_CHAN_NONE) != ESP_OK) {
-    Serial.printf("Fehler beim Setzen des Kanals auf %d\n", ESP_NOW_RECEIVER_CHANNEL);
+    ECO_LOGE("Fehler beim Setzen des Kanals auf %d", ESP_NOW_RECEIVER_CHANNEL);
     tft.println("Kanal Fehler!");
     return;
   }
-  // esp_wifi_set_promiscuous(false);
+#if LINK_REPORT
+  // Nur Management-Frames (ESP-NOW), für die RSSI je Sender
+  wifi_promiscuous_filter_t filter = { WIFI_PROMIS_FILTER_MASK_MGMT };
+  esp_wifi_set_promiscuous_filter(&filter);
+  esp_wifi_set_promiscuous_rx_cb(onPromiscuous);
+  esp_wifi_set_promiscuous(true);
+#endif
 
   if (esp_now_init() != ESP_OK) {
-    Serial.println("Fehler bei der Initialisierung von ESP-NOW.");
+    ECO_LOGE("Fehler bei der Initialisierung von ESP-NOW.");
     tft.println("ESP-NOW Init Fehler!");
     return;
   }
 
+  // Verarbeitungs-Task vor dem Callback starten, damit keine Pakete verloren gehen
+  xTaskCreatePinnedToCore(rxTask, "espnow_rx", 4096, nullptr, 5, &rxTaskHandle, 0);
   esp_now_register_recv_cb(OnDataRecv);
-  Serial.printf("ESP-NOW initialisiert. Lausche auf Kanal %d.\n", ESP_NOW_RECEIVER_CHANNEL);
+  ECO_LOGI("ESP-NOW initialisiert. Lausche auf Kanal %d.", ESP_NOW_RECEIVER_CHANNEL);
 }
 
+// loop() ist der UI-Task: Fortschritt (max. UI_FPS) und Anzeige fertiger Bilder
 void loop() {
-  if (newImageReadyToDisplay) {
-    newImageReadyToDisplay = false; // Flag zurücksetzen
+#if ECO_LOG_BACKEND == ECO_LOG_RING
+  // 'l' über Serial: gesammelte Log-Einträge ausgeben
+  if (Serial.available() > 0 && Serial.read() == 'l') {
+    ecoLogDump([](const char* line) { Serial.println(line); });
+  }
+#endif
+  bool live = true; // beim Blättern im Verlauf werden neue Bilder nur eingetragen
+#if IMAGE_HISTORY
+  uint8_t press = pollBrowseButton();
+  if (press != 0) browseInput(press);
+  if (viewMode != VIEW_LIVE && millis() - browseLastInput > BROWSE_TIMEOUT_MS) browseExit();
+  live = viewMode == VIEW_LIVE;
+#endif
+  if (live) {
+    drawProgress();
+    drawHeartbeat();
+  }
 
-    if (imageDataBuffer != nullptr && imageBufferSize > 0) {
-      Serial.printf("Zeige Bild ID %u (%u Bytes) an...\n", currentImageId, imageBufferSize);
+#if PROGRESSIVE_DISPLAY
+  StreamRequest req;
+  if (uxQueueMessagesWaiting(displayQueue) == 0 && xQueueReceive(streamQueue, &req, 0) == pdTRUE) {
+    RxSlot& slot = rxSlots[req.slot];
+    if (live && slot.state == RxSlot::RECEIVING && slot.assembly.imageId() == req.imageId) {
+      streamDecode(slot, req.imageId);
+    }
+  }
+#endif
+
+  uint8_t slotIdx;
+  if (xQueueReceive(displayQueue, &slotIdx, 0) == pdTRUE) {
+    RxSlot& slot = rxSlots[slotIdx];
+    uint32_t imageId = slot.assembly.imageId();
+    uint32_t imageSize = slot.assembly.totalSize();
+    JRESULT result = JDR_OK;
+    bool stale = live && slot.live && !slot.streamed && newerImageWaiting();
+    if (stale) {
+      ++liveStats.staleDropped;
+    } else if (!slot.streamed && live && slot.live) {
+      result = drawImage(slot.buffer, imageSize, true); // ohne Leeren, kein Aufblitzen zwischen Bildern
+    } else if (!slot.streamed && live) {
+      ECO_LOGI("Zeige Bild ID %u (%u Bytes) von %02X:%02X an...", imageId, imageSize, slot.mac[4], slot.mac[5]);
       tft.fillScreen(TFT_BLACK); // Bildschirm leeren
 
-      // TJpg_Decoder aufrufen, um das Bild zu zeichnen
-      // Die x,y Koordinaten sind die obere linke Ecke des Bildes auf dem Display
-      JRESULT result = TJpgDec.drawJpg(0, 0, imageDataBuffer, imageBufferSize);
+      result = drawImage(slot.buffer, imageSize);
+    }
 
-      if (result == JDR_OK) {
-        Serial.println("Bild erfolgreich angezeigt.");
-        tft.setCursor(5, tft.height() - 40); // Unten auf dem Display
-        tft.setTextSize(1);
-        tft.setTextColor(TFT_YELLOW, TFT_BLACK);
-        tft.printf("Bild ID: %u | VBat: %.2fV", currentImageId, lastVBat_mV / 1000.0f);
-      } else {
-        Serial.printf("Fehler beim Dekodieren/Anzeigen des JPEGs: %d\n", result);
-        tft.fillScreen(TFT_RED);
-        tft.setCursor(10,10);
-        tft.setTextSize(2);
-        tft.setTextColor(TFT_WHITE);
-        tft.println("JPEG Fehler!");
-        tft.printf("Code: %d", result);
-      }
-      // Speicher für das aktuelle Bild freigeben
-      free(imageDataBuffer);
-      imageDataBuffer = nullptr;
-      imageBufferSize = 0;
-      receivedImageBytes = 0; // Zurücksetzen für das nächste Bild
-      // currentImageId bleibt für die Anzeige, wird beim nächsten Empfang überschrieben
+    // JDR_INTR: tft_output hat am unteren Bildschirmrand abgebrochen
+    if (!live) {
+      if (!slot.live) ECO_LOGI("Bild ID %u empfangen, Anzeige waehrend des Blaetterns ausgesetzt.", imageId);
+    } else if (stale) {
+      // übersprungen, das neuere Bild folgt direkt
+    } else if ((result == JDR_OK || result == JDR_INTR) && slot.live) {
+      drawLiveStats(slot, slot.streamed ? slot.shownMs : millis());
+    } else if (result == JDR_OK || result == JDR_INTR) {
+      ECO_LOGI("Bild erfolgreich angezeigt.");
+      drawImageCaption(slot.mac, imageId, slot.vbat_mV);
+      if (slot.hasProfile) drawWakeProfile(slot.profile);
     } else {
-      Serial.println("Keine gültigen Bilddaten zum Anzeigen vorhanden.");
+      ECO_LOGE("Fehler beim Dekodieren/Anzeigen des JPEGs: %d", result);
+      tft.fillScreen(TFT_RED);
+      tft.setCursor(10,10);
+      tft.setTextSize(2);
+      tft.setTextColor(TFT_WHITE);
+      tft.println("JPEG Fehler!");
+      tft.printf("Code: %d", result);
     }
-     // Nach Anzeige wieder auf neue Bilder warten
-    if (!imageReceiveInProgress) { // Nur wenn nicht schon ein neues Bild empfangen wird
-        tft.setCursor(10, tft.height() / 2); // Zentrierter
-        tft.setTextSize(2);
-        tft.setTextColor(TFT_WHITE, TFT_BLACK);
-        // tft.println("Warte auf Bilder..."); // Kann die VBat Anzeige überdecken
+#if IMAGE_HISTORY
+    // Live-Bilder nicht in den Verlauf, sie würden ihn in Sekunden verdrängen
+    if (!slot.live) {
+      if (result == JDR_OK || result == JDR_INTR) historyAdd(slot);
+      if (viewMode == VIEW_GRID) drawHistoryGrid(); // neues Bild als erste Kachel
     }
+#endif
+    // Slot für den nächsten Empfang freigeben
+    slot.state = RxSlot::FREE;
   }
   delay(10); // Kurze Pause
 }
@@ -0,0 +1,128 @@
+#include "FrameQueue.h"
+#include "EcoLog.h"
+#include <LittleFS.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char*    QUEUE_DIR = "/queue";
+static const uint32_t QUEUE_MAGIC = 0x51464345; // "ECFQ"
+
+struct QueueFileHeader {
+  uint32_t magic;
+  QueuedFrameInfo info;
+};
+
+String FrameQueue::pathFor(uint32_t seq) const {
+  char path[24];
+  snprintf(path, sizeof(path), "%s/%08lu.img", QUEUE_DIR, (unsigned long)seq);
+  return String(path);
+}
+
+bool FrameQueue::begin() {
+  if (_ready) return true;
+  if (!LittleFS.begin(true)) {
+    ECO_LOGE("[Queue] LittleFS konnte nicht eingehängt werden");
+    return false;
+  }
+  if (!LittleFS.exists(QUEUE_DIR)) LittleFS.mkdir(QUEUE_DIR);
+
+  // Vorhandene Einträge zählen; die Dateinummern ergeben die Reihenfolge
+  _count = 0;
+  _bytes = 0;
+  bool any = false;
+  File dir = LittleFS.open(QUEUE_DIR);
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    const char* name = strrchr(f.name(), '/'); // ältere Cores liefern den vollen Pfad
+    uint32_t seq = strtoul(name ? name + 1 : f.name(), nullptr, 10);
+    if (!any || seq < _head) _head = seq;
+    if (!any || seq >= _tail) _tail = seq + 1;
+    any = true;
+    ++_count;
+    _bytes += f.size();
+    f.close();
+  }
+  dir.close();
+  if (!any) _head = _tail = 0;
+  _ready = true;
+  if (_count > 0) {
+    ECO_LOGI("[Queue] %u Bilder (%lu Bytes) warten auf Versand", _count, (unsigned long)_bytes);
+  }
+  return true;
+}
+
+void FrameQueue::advanceHead() {
+  // Lücken (z.B. durch abgebrochene Schreibvorgänge) überspringen
+  while (_count > 0 && _head < _tail && !LittleFS.exists(pathFor(_head))) ++_head;
+}
+
+void FrameQueue::popOldest() {
+  if (!_ready || _count == 0) return;
+  advanceHead();
+  String path = pathFor(_head);
+  File f = LittleFS.open(path, FILE_READ);
+  uint32_t size = f ? f.size() : 0;
+  if (f) f.close();
+  LittleFS.remove(path);
+  ++_head;
+  --_count;
+  _bytes = _bytes > size ? _bytes - size : 0;
+}
+
+bool FrameQueue::push(const uint8_t* buf, size_t len, const QueuedFrameInfo& info) {
+  if (!_ready || _maxFrames == 0) return false;
+  uint32_t fileSize = sizeof(QueueFileHeader) + len;
+  if (fileSize > _maxBytes) {
+    ECO_LOGE("[Queue] Bild zu groß für Zwischenspeicher (%u Bytes)", len);
+    return false;
+  }
+  while (_count > 0 && (_count >= _maxFrames || _bytes + fileSize > _maxBytes)) {
+    ECO_LOGW("[Queue] Speicher voll, verwerfe ältestes Bild");
+    popOldest();
+  }
+
+  String path = pathFor(_tail);
+  File f = LittleFS.open(path, FILE_WRITE);
+  if (!f) {
+    ECO_LOGE("[Queue] Datei konnte nicht angelegt werden");
+    return false;
+  }
+  QueueFileHeader hdr;
+  hdr.magic = QUEUE_MAGIC;
+  hdr.info = info;
+  hdr.info.len = len;
+  bool ok = f.write((const uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) &&
+            f.write(buf, len) == len;
+  f.close();
+  if (!ok) {
+    ECO_LOGE("[Queue] Schreibfehler, Bild verworfen");
+    LittleFS.remove(path);
+    return false;
+  }
+  if (_count == 0) _head = _tail;
+  ++_tail;
+  ++_count;
+  _bytes += fileSize;
+  ECO_LOGI("[Queue] Bild gespeichert (%u im Speicher, %lu Bytes)", _count, (unsigned long)_bytes);
+  return true;
+}
+
+uint8_t* FrameQueue::loadOldest(QueuedFrameInfo& info) {
+  if (!_ready || _count == 0) return nullptr;
+  advanceHead();
+  File f = LittleFS.open(pathFor(_head), FILE_READ);
+  if (!f) return nullptr;
+
+  QueueFileHeader hdr;
+  uint8_t* buf = nullptr;
+  if (f.read((uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == QUEUE_MAGIC &&
+      hdr.info.len == f.size() - sizeof(hdr)) {
+    buf = (uint8_t*)(psramFound() ? ps_malloc(hdr.info.len) : malloc(hdr.info.len));
+    if (buf != nullptr && f.read(buf, hdr.info.len) != hdr.info.len) {
+      free(buf);
+      buf = nullptr;
+    }
+  }
+  f.close();
+  if (buf != nullptr) info = hdr.info;
+  return buf;
+}
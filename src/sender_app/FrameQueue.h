@@ -0,0 +1,53 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – Zwischenspeicher für nicht gesendete Bilder
+//  Bilder landen als Dateien im LittleFS (/queue/<nr>.img) und werden
+//  beim nächsten erfolgreichen Verbindungsaufbau nachgesendet.
+//  Bei Überschreiten der Grenzen wird das älteste Bild verworfen.
+// ────────────────────────────────────────────────────────────────
+#ifndef ECOSNAP_FRAME_QUEUE_H
+#define ECOSNAP_FRAME_QUEUE_H
+
+#include <Arduino.h>
+
+// Metadaten eines gespeicherten Bildes (liegen vor den JPEG-Daten in der Datei)
+struct QueuedFrameInfo {
+  uint32_t image_id;
+  uint32_t captured_s;     // RTC-Zeit der Aufnahme in s (läuft im Deep Sleep weiter)
+  uint32_t len;            // Größe der JPEG-Daten
+  uint16_t vbat_mv;
+  char     esp_id[13];
+  char     wake_reason[9];
+};
+
+class FrameQueue {
+public:
+  FrameQueue(uint16_t maxFrames, uint32_t maxBytes) : _maxFrames(maxFrames), _maxBytes(maxBytes) {}
+
+  // Dateisystem einhängen (bei Bedarf formatieren) und vorhandene Einträge einlesen
+  bool begin();
+
+  // Bild anhängen; verdrängt älteste Einträge, bis die Grenzen eingehalten sind
+  bool push(const uint8_t* buf, size_t len, const QueuedFrameInfo& info);
+
+  // Liest das älteste Bild in einen neu allokierten Puffer (PSRAM, falls vorhanden).
+  // Der Aufrufer gibt ihn mit free() frei; nullptr wenn leer oder Lesefehler.
+  uint8_t* loadOldest(QueuedFrameInfo& info);
+  void popOldest();
+
+  uint16_t count() const { return _count; }
+  uint32_t bytes() const { return _bytes; }
+
+private:
+  String pathFor(uint32_t seq) const;
+  void advanceHead();
+
+  uint16_t _maxFrames;
+  uint32_t _maxBytes;
+  bool     _ready = false;
+  uint32_t _head = 0;   // Nummer des ältesten Eintrags
+  uint32_t _tail = 0;   // Nummer für den nächsten Eintrag
+  uint16_t _count = 0;
+  uint32_t _bytes = 0;  // Summe der Dateigrößen
+};
+
+#endif // ECOSNAP_FRAME_QUEUE_H
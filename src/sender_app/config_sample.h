@@ -9,6 +9,15 @@ const char* password = "DEIN_WLAN_PASSWORT";  // Tragen Sie hier Ihr WLAN-Passwo
 // Server URL für HTTP Upload
 const char* serverURL = "http://DEIN_SERVER.DE/DEIN_UPLOAD_PFAD/upload.php"; // Tragen Sie hier Ihre HTTP Server-URL ein
 
+// Schnellverbindung: BSSID, Kanal und IP der letzten Verbindung werden im RTC-Speicher
+// gemerkt und beim nächsten Wecken ohne Scan/DHCP genutzt (Fallback: normale Verbindung).
+#define WIFI_FAST_CONNECT 1 // 1 = aktiv, 0 = immer Scan + DHCP
+
+// Fortsetzbarer Upload in Segmenten (benötigt das aktuelle upload.php auf dem Server).
+// Nach einem Abbruch wird beim letzten bestätigten Offset fortgesetzt.
+#define HTTP_RESUMABLE_UPLOAD 1     // 0 = Bild in einem Request senden (ältere Server)
+#define UPLOAD_SEGMENT_SIZE 16384   // Bytes pro Segment
+
 // ---------------- ESP-NOW Upload (Optional) ----------------
 // Auf true setzen, um ESP-NOW anstelle von HTTP/HTTPS für den Bild-Upload zu verwenden.
 // ACHTUNG: Erfordert einen ESP-NOW Empfänger auf der Gegenseite.
@@ -24,8 +33,88 @@ static uint8_t espNowReceiverMac[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 // Sender und Empfänger müssen auf demselben Kanal sein für zuverlässige Kommunikation.
 // Wenn der Empfänger auf einem festen Kanal lauscht, hier denselben Kanal eintragen.
 #define ESP_NOW_CHANNEL 1 // Fest auf Kanal 1 setzen, passend zum Empfänger
+
+// Anzahl gleichzeitig gesendeter, noch unbestätigter Chunks (Sliding Window).
+// Fehlgeschlagene Chunks werden einzeln wiederholt (max. ESP_NOW_MAX_RETRIES_PER_CHUNK).
+#define ESP_NOW_WINDOW_SIZE 8
+#define ESP_NOW_MAX_RETRIES_PER_CHUNK 5
+
+// Nach jeder Runde meldet der Empfänger fehlende Chunks per NACK; nur diese werden nachgesendet.
+#define ESP_NOW_NACK_TIMEOUT_MS 300 // Wartezeit auf NACK/ACK
+#define ESP_NOW_MAX_NACK_ROUNDS 4   // Max. Nachsende-Runden
+#define ESP_NOW_PROTOCOL_VERSION 2  // 2 = große Pakete (neuer Empfänger), 1 = nur altes Format
+// CRC32 je Chunk und über das ganze Bild (nur v2). Der Empfänger verwirft beschädigte
+// Chunks und fordert sie per NACK neu an; kostet 8 Bytes Nutzlast pro Chunk.
+#define ESP_NOW_CHUNK_CRC 1
+// Vorwärtsfehlerkorrektur (nur v2, wenn der Empfänger sie meldet): auf je ESP_NOW_FEC_K
+// Chunks folgen M Paritäts-Chunks, aus denen der Empfänger bis zu M verlorene Chunks der
+// Gruppe ohne NACK-Runde wiederherstellt. M = -1 wählt 0-2 nach dem gemeldeten Verlust.
+#define ESP_NOW_FEC 1
+#define ESP_NOW_FEC_K 8
+#define ESP_NOW_FEC_M -1
+// CPU-Takt während der Übertragung in MHz (0 = unverändert). Der Sender wartet
+// blockierend auf die Sende-Callbacks; mit 80 MHz sinkt der Strom in dieser Zeit.
+#define ESP_NOW_CPU_MHZ 80
+// Link-Anpassung: der Empfänger meldet nach jedem Bild RSSI und Verlust. Daraus wählt der
+// Sender beim nächsten Wecken Datenrate (1 bis 24 Mbit/s) und Sendeleistung. Nach einer
+// fehlgeschlagenen Übertragung wird wieder mit 1 Mbit/s und voller Leistung begonnen.
+#define LINK_ADAPT 1
+#define LINK_TX_MAX_DBM 20    // Sendeleistung ohne Bericht
+#define LINK_TX_MIN_DBM 2
+#define LINK_MARGIN_DB 6      // Reserve über der RSSI-Schwelle der gewählten Rate
+
+// Live-Modus: die Kamera nimmt laufend auf und streamt an den Empfänger, der Bildrate und
+// Latenz anzeigt (z.B. zum Ausrichten). Aktiv mit LIVE_STREAM 1 oder wenn LIVE_STREAM_PIN
+// beim Start auf GND liegt (z.B. 15; Brücke entfernen beendet den Live-Modus). Nur nach
+// Einschalten oder Reset; das Wecken aus dem Deep Sleep nimmt immer Einzelbilder auf.
+#define LIVE_STREAM 0
+#define LIVE_STREAM_PIN -1             // -1 = kein Pin
+#define LIVE_FRAMESIZE FRAMESIZE_QVGA
+#define LIVE_QUALITY 15
+#define LIVE_FPS 10
+#define LIVE_MAX_SECONDS 600           // danach Deep Sleep und normaler Betrieb (0 = unbegrenzt)
 #endif
 
+// ---------------- PIR-Serienaufnahme ----------------
+// Bei Bewegungserkennung (PIR) werden mehrere Bilder direkt hintereinander aufgenommen
+// und gemeinsam übertragen.
+#define PIR_BURST_FRAMES 3      // Bilder pro PIR-Auslösung (1 = nur ein Bild)
+#define PIR_BURST_INTERVAL_MS 0 // Pause zwischen den Bildern (0 = so schnell wie der Sensor)
+
+// ---------------- Änderungserkennung ----------------
+// Timer-Bilder werden per Vorschaubild mit dem zuletzt gesendeten Bild verglichen.
+// Ist die Szene unverändert, wird kein Bild gesendet (spart den Großteil der Funkzeit).
+#define CHANGE_DETECT 1       // 1 = aktiv, 0 = jedes Timer-Bild senden
+#define CHANGE_THRESHOLD 6    // Mittlere Helligkeitsdifferenz (0-255), ab der gesendet wird
+#define CHANGE_HEARTBEAT 1    // 1 = stattdessen nur VBat melden, 0 = gar nichts senden
+#define CHANGE_MAX_SKIPS 12   // Spätestens nach so vielen ausgelassenen Bildern wieder senden
+
+// ---------------- Bitraten-Regelung ----------------
+// JPEG-Qualität und Auflösung werden anhand der letzten Bildgrößen (RTC-Speicher) so
+// gewählt, dass ein Bild das Budget des Übertragungswegs einhält. Ist ein Bild trotzdem
+// zu groß, wird es einmal mit niedrigerer Qualität bzw. Auflösung neu aufgenommen.
+#define RATE_CONTROL 1                     // 0 = fest SVGA, Qualität 12
+#define RATE_BUDGET_ESPNOW 40000           // Zielgröße pro Bild bei ESP-NOW (Bytes)
+#define RATE_BUDGET_HTTP 80000             // Zielgröße pro Bild bei HTTP (Bytes)
+#define RATE_QUALITY_BEST 10               // jpeg_quality 0-63: kleiner = besser und größer
+#define RATE_QUALITY_WORST 30
+#define RATE_FRAMESIZE_MAX FRAMESIZE_SVGA  // Größte Auflösung
+#define RATE_FRAMESIZE_MIN FRAMESIZE_VGA   // Kleinste Auflösung; mind. QVGA, da die Änderungserkennung das Bild
+                                           // auf 1/8 dekodiert und >= 32x24 Pixel braucht (>= 256x192)
+
+// ---------------- Zwischenspeicher (Store-and-Forward) ----------------
+// Nicht gesendete Bilder werden im LittleFS abgelegt und beim nächsten erfolgreichen
+// Verbindungsaufbau nachgesendet (älteste zuerst). Bei vollem Speicher wird das älteste verworfen.
+#define FRAME_QUEUE_MAX_FRAMES 20           // 0 = deaktiviert
+#define FRAME_QUEUE_MAX_BYTES (1024 * 1024) // Max. Speicherbelegung in Bytes
+
+// ---------------- Wachzeit-Profil ----------------
+// Dauer der einzelnen Phasen eines Weckzyklus (Boot, VBat, Kamera, Aufnahme, Verbindung,
+// Upload, Sleep). Das Profil des vorigen Zyklus wird mit dem ersten Upload gesendet
+// (HTTP: Parameter prof/prof_wake, ESP-NOW: Header-Erweiterung in Chunk 0).
+#define WAKE_PROFILE_SEND 1      // 0 = nur im seriellen Log ausgeben
+#define WAKE_PROFILE_HISTORY 8   // Anzahl Zyklen im RTC-Speicher
+
 // ---------------- Deep-Sleep Konfiguration ----------------
 // Dauer des Deep-Sleeps in Minuten
 constexpr uint64_t SLEEP_DURATION_MINUTES = 15;  // Standardwert: 15 Minuten
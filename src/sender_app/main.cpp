@@ -8,11 +8,15 @@
 #include <esp_now.h>
 #include <HTTPClient.h>
 #include "esp_camera.h"
+#include "img_converters.h"   // jpg2rgb565 für das Vorschaubild
 #include "esp_sleep.h"
 #include "esp_wifi.h"        // Für WiFi Power Management
 #include "esp_bt.h"          // Für Bluetooth deaktivieren
 #include "driver/adc.h"      // Für ADC Power Management
+#include <sys/time.h>
 #include "config.h"
+#include "FrameQueue.h"
+#include "EcoLog.h"
 
 // Brown‑Out‑Detector und RTC deaktivieren
 #include "soc/soc.h"
@@ -32,28 +36,241 @@ static constexpr int        VBAT_PIN = 14;
 static bool camera_initialized = false;
 static bool bt_initialized = false;
 
+#include "EspNowProtocol.h"  // auch für HTTP: CRC32 des Bildes beim fortsetzbaren Upload
 #if USE_ESP_NOW
-// ESP-NOW spezifische Definitionen (unverändert)
-esp_now_peer_info_t peerInfo;
-volatile bool espNowSendSuccess = false;
+#include "EspNowSender.h"
+
+// Sliding-Window Parameter (Standardwerte, überschreibbar in config.h)
+#ifndef ESP_NOW_WINDOW_SIZE
+#define ESP_NOW_WINDOW_SIZE 8          // Max. gleichzeitig unbestätigte Chunks
+#endif
+#ifndef ESP_NOW_MAX_RETRIES_PER_CHUNK
+#define ESP_NOW_MAX_RETRIES_PER_CHUNK 5 // Wiederholungen pro Chunk, danach Abbruch
+#endif
+#ifndef ESP_NOW_TX_GAP_MS
+#define ESP_NOW_TX_GAP_MS 0            // Optionale Pause zwischen Sendungen (für alte Empfänger ~20)
+#endif
+#ifndef ESP_NOW_NACK_TIMEOUT_MS
+#define ESP_NOW_NACK_TIMEOUT_MS 300    // Wartezeit auf NACK/ACK des Empfängers nach einer Runde
+#endif
+#ifndef ESP_NOW_MAX_NACK_ROUNDS
+#define ESP_NOW_MAX_NACK_ROUNDS 4      // Max. Nachsende-Runden aufgrund von NACKs
+#endif
+#ifndef ESP_NOW_PROTOCOL_VERSION
+#define ESP_NOW_PROTOCOL_VERSION 2     // Höchste genutzte Protokollversion (1 = nur altes Format)
+#endif
+#ifndef ESP_NOW_CHUNK_CRC
+#define ESP_NOW_CHUNK_CRC 1            // CRC32 je Chunk und über das ganze Bild (nur v2, 8 Bytes/Chunk)
+#endif
+#ifndef ESP_NOW_FEC
+#define ESP_NOW_FEC 1                  // Paritäts-Chunks je Gruppe (nur v2, wenn der Empfänger FEC meldet)
+#endif
+#ifndef ESP_NOW_FEC_K
+#define ESP_NOW_FEC_K 8                // Daten-Chunks je FEC-Gruppe (max. 32)
+#endif
+#ifndef ESP_NOW_FEC_M
+#define ESP_NOW_FEC_M -1               // Paritäts-Chunks je Gruppe (0-4); -1 = nach gemeldetem Verlust
+#endif
+#ifndef ESP_NOW_CPU_MHZ
+#define ESP_NOW_CPU_MHZ 80             // CPU-Takt während der Übertragung (0 = unverändert, WiFi braucht >= 80)
+#endif
+#ifndef LINK_ADAPT
+#define LINK_ADAPT 1                   // Datenrate und Sendeleistung nach dem LINK-Bericht des Empfängers
+#endif
+#ifndef LINK_TX_MAX_DBM
+#define LINK_TX_MAX_DBM 20             // Sendeleistung ohne Bericht bzw. nach einem Fehlschlag
+#endif
+#ifndef LINK_TX_MIN_DBM
+#define LINK_TX_MIN_DBM 2
+#endif
+#ifndef LINK_MARGIN_DB
+#define LINK_MARGIN_DB 6               // Reserve über der RSSI-Schwelle der gewählten Rate
+#endif
+#ifndef LINK_LOSS_HIGH_PCT
+#define LINK_LOSS_HIGH_PCT 10          // Ab diesem Verlust eine Rate langsamer
+#endif
 
-#define ESP_NOW_MAX_DATA_PER_CHUNK (250 - 15) 
+esp_now_peer_info_t peerInfo;
 
-typedef struct __attribute__((packed)) esp_now_image_chunk_t {
-    uint32_t image_id;
-    uint32_t total_size;
-    uint16_t chunk_index;
-    uint16_t total_chunks;
-    uint8_t  data_len;
-    uint8_t  vbat_mv_high;
-    uint8_t  vbat_mv_low;
-    uint8_t  data[ESP_NOW_MAX_DATA_PER_CHUNK];
-} esp_now_image_chunk_t;
+// Sliding Window und NACK-Runden (lib/EcoSnapProtocol), Callbacks werden durchgereicht
+static EspNowSender espNowSender({
+  ESP_NOW_WINDOW_SIZE, ESP_NOW_MAX_RETRIES_PER_CHUNK, ESP_NOW_TX_GAP_MS,
+  ESP_NOW_NACK_TIMEOUT_MS, ESP_NOW_MAX_NACK_ROUNDS, 3000
+});
 
 static void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-  espNowSendSuccess = (status == ESP_NOW_SEND_SUCCESS);
+  espNowSender.onSent(status == ESP_NOW_SEND_SUCCESS);
 }
+
+// Vom Empfänger gemeldete Fähigkeiten (CAPS), über Deep Sleep hinweg gemerkt.
+// Bis zur ersten Meldung wird im v1-Format gesendet, das jeder Empfänger versteht.
+RTC_DATA_ATTR uint8_t  espNowPeerVersion = ESP_NOW_PROTOCOL_V1;
+RTC_DATA_ATTR uint16_t espNowPeerMaxPayload = ESP_NOW_MAX_PAYLOAD;
+RTC_DATA_ATTR uint8_t  espNowPeerFeatures = 0;   // ESP_NOW_CAPS_FEATURE_*
+
+// ───────── Link-Anpassung ─────────
+// Der Empfänger meldet nach jedem Bild RSSI und Verlust (LINK). Daraus werden für das
+// nächste Wecken ESP-NOW Datenrate und Sendeleistung gewählt: nahe Kameras senden
+// schneller und leiser, entfernte fallen auf robuste Raten zurück. Die RSSI wird auf
+// volle Sendeleistung umgerechnet, da der Bericht mit der damals genutzten entstand.
+struct LinkRate {
+  wifi_phy_rate_t rate;
+  int8_t          minRssi;  // ab dieser RSSI (bei voller Leistung) nutzbar, inkl. Reserve zur Empfindlichkeit
+  const char*     name;
+};
+
+static const LinkRate LINK_RATES[] = {
+  { WIFI_PHY_RATE_1M_L, -85, "1M"  },   // Standardrate, immer nutzbar
+  { WIFI_PHY_RATE_2M_L, -80, "2M"  },
+  { WIFI_PHY_RATE_6M,   -75, "6M"  },
+  { WIFI_PHY_RATE_12M,  -70, "12M" },
+  { WIFI_PHY_RATE_24M,  -64, "24M" },
+};
+static constexpr uint8_t LINK_RATE_COUNT = sizeof(LINK_RATES) / sizeof(LINK_RATES[0]);
+
+struct LinkState {
+  bool     reportValid;   // Bericht zur letzten Übertragung liegt vor
+  int8_t   rssi;          // mittlere RSSI laut Bericht
+  uint8_t  lossPct;
+  int8_t   reportTxDbm;   // Sendeleistung, mit der der Bericht entstand
+  uint8_t  rateIdx;       // gewählt für dieses Wecken
+  int8_t   txDbm;
+};
+RTC_DATA_ATTR LinkState linkState = { false, 0, 0, LINK_TX_MAX_DBM, 0, LINK_TX_MAX_DBM };
+
+// Aus dem Empfangs-Callback
+static void linkReport(const esp_now_link_t& msg) {
+  linkState.rssi = msg.rssi_avg;
+  linkState.lossPct = msg.loss_pct;
+  linkState.reportTxDbm = linkState.txDbm;
+  linkState.reportValid = msg.rssi_avg != 0;
+}
+
+// Wählt Rate und Leistung aus dem letzten Bericht; höchstens eine Rate schneller je Wecken
+static void linkChoose() {
+  if (!linkState.reportValid) {
+    linkState.rateIdx = 0;
+    linkState.txDbm = LINK_TX_MAX_DBM;
+    return;
+  }
+  int rssiFull = linkState.rssi + (LINK_TX_MAX_DBM - linkState.reportTxDbm);
+  uint8_t idx = 0;
+  while (idx + 1 < LINK_RATE_COUNT && rssiFull >= LINK_RATES[idx + 1].minRssi + LINK_MARGIN_DB) ++idx;
+  uint8_t last = linkState.rateIdx;
+  if (idx > last + 1) idx = last + 1;
+  if (linkState.lossPct != ESP_NOW_LINK_LOSS_UNKNOWN && linkState.lossPct > LINK_LOSS_HIGH_PCT && idx >= last) {
+    idx = last > 0 ? last - 1 : 0;
+  }
+  // Leistung so weit senken, dass die Reserve über der Schwelle der Rate bleibt
+  int excess = rssiFull - (LINK_RATES[idx].minRssi + LINK_MARGIN_DB);
+  int dbm = LINK_TX_MAX_DBM - (excess > 0 ? excess : 0);
+  linkState.rateIdx = idx;
+  linkState.txDbm = constrain(dbm, LINK_TX_MIN_DBM, LINK_TX_MAX_DBM);
+}
+
+// Nach WiFi-Start und vor esp_now_init()
+static void linkApply() {
+#if LINK_ADAPT
+  linkChoose();
 #endif
+  const LinkRate& r = LINK_RATES[linkState.rateIdx];
+  esp_err_t err = esp_wifi_config_espnow_rate(WIFI_IF_STA, r.rate);
+  if (err != ESP_OK) {
+    ECO_LOGW("[Link] Rate %s nicht einstellbar: %s", r.name, esp_err_to_name(err));
+    linkState.rateIdx = 0;
+  }
+  esp_wifi_set_max_tx_power(linkState.txDbm * 4); // in 0,25 dBm
+  if (linkState.reportValid) {
+    ECO_LOGI("[Link] RSSI %d dBm bei %d dBm, Verlust %u%% -> Rate %s, Sendeleistung %d dBm",
+             linkState.rssi, linkState.reportTxDbm, linkState.lossPct,
+             LINK_RATES[linkState.rateIdx].name, linkState.txDbm);
+  } else {
+    ECO_LOGI("[Link] Kein Bericht -> Rate %s, Sendeleistung %d dBm",
+             LINK_RATES[linkState.rateIdx].name, linkState.txDbm);
+  }
+}
+
+// Paritäts-Chunks je Gruppe für das nächste Bild. Adaptiv nach dem Verlust des letzten
+// Berichts: verlustfreie Strecken senden ohne Overhead, ohne Bericht eine Parität.
+static uint8_t fecParity() {
+#if ESP_NOW_FEC_M >= 0
+  return ESP_NOW_FEC_M;
+#else
+  if (!linkState.reportValid || linkState.lossPct == ESP_NOW_LINK_LOSS_UNKNOWN) return 1;
+  if (linkState.lossPct < 2) return 0;
+  return linkState.lossPct < LINK_LOSS_HIGH_PCT ? 1 : 2;
+#endif
+}
+
+static void OnDataRecv(const uint8_t *mac_addr, const uint8_t *data, int len) {
+  const esp_now_caps_t* caps = espNowParseCaps(data, len);
+  if (caps != nullptr) {
+    espNowPeerVersion = caps->max_version;
+    espNowPeerMaxPayload = caps->max_payload;
+    espNowPeerFeatures = espNowCapsFeatures(data, len);
+    return;
+  }
+  if (const esp_now_link_t* link = espNowParseLink(data, len)) {
+    linkReport(*link);
+    return;
+  }
+  espNowSender.onReceive(data, len);
+}
+#endif
+
+// ───────── Wachzeit-Profil ─────────
+// Dauer jeder Phase eines Weckzyklus (esp_timer, µs seit Start der App). Die letzten
+// WAKE_PROFILE_HISTORY Zyklen liegen im RTC-Speicher. Mitgesendet wird das Profil des
+// letzten vollständigen Zyklus, da Upload- und Sleep-Phase des laufenden noch offen sind.
+#include "WakeProfile.h"
+#include "esp_timer.h"
+
+#ifndef WAKE_PROFILE_SEND
+#define WAKE_PROFILE_SEND 1         // Profil mit dem ersten Upload eines Zyklus senden
+#endif
+#ifndef WAKE_PROFILE_HISTORY
+#define WAKE_PROFILE_HISTORY 8      // Anzahl Zyklen im RTC-Verlauf
+#endif
+
+struct WakeProfileHistory {
+  uint32_t wakes;                   // Abgeschlossene Zyklen seit Power-On
+  WakeProfile entries[WAKE_PROFILE_HISTORY];
+};
+RTC_DATA_ATTR WakeProfileHistory wakeHistory;
+
+static WakeProfile wakeCurrent;
+static WakePhase wakePhase = WAKE_BOOT;
+static int64_t wakePhaseStart = 0;  // esp_timer zählt ab Start der App
+static bool wakeProfileSent = false;
+
+// Schließt die laufende Phase ab und beginnt die nächste (auch dieselbe erneut)
+static void profilePhase(WakePhase next) {
+  int64_t now = esp_timer_get_time();
+  uint32_t ms = wakeCurrent.phase_ms[wakePhase] + (uint32_t)((now - wakePhaseStart) / 1000);
+  wakeCurrent.phase_ms[wakePhase] = ms > 0xFFFF ? 0xFFFF : ms;
+  wakePhase = next;
+  wakePhaseStart = now;
+}
+
+// Profil des letzten vollständigen Zyklus, sofern noch nicht in diesem Zyklus gesendet
+static bool profileToSend(WakeProfile& out) {
+  if (!WAKE_PROFILE_SEND || wakeProfileSent || wakeHistory.wakes == 0) return false;
+  out = wakeHistory.entries[(wakeHistory.wakes - 1) % WAKE_PROFILE_HISTORY];
+  return true;
+}
+
+// Direkt vor dem Deep Sleep: Zyklus abschließen, in den RTC-Verlauf übernehmen und ausgeben
+static void profileFinish() {
+  profilePhase(WAKE_SLEEP);
+  wakeHistory.entries[wakeHistory.wakes % WAKE_PROFILE_HISTORY] = wakeCurrent;
+  ++wakeHistory.wakes;
+  // Eine Zeile je Zyklus, damit sie im Ringpuffer ein Eintrag bleibt
+  static_assert(WAKE_PHASE_COUNT == 7, "Profil-Ausgabe an die Phasen anpassen");
+  const uint16_t* ms = wakeCurrent.phase_ms;
+  ECO_LOGI("[Profil] Zyklus %lu: boot=%u vbat=%u cam=%u capture=%u link=%u upload=%u sleep=%u gesamt=%lu ms",
+           (unsigned long)wakeHistory.wakes, ms[WAKE_BOOT], ms[WAKE_VBAT], ms[WAKE_CAMERA], ms[WAKE_CAPTURE],
+           ms[WAKE_LINK], ms[WAKE_UPLOAD], ms[WAKE_SLEEP], (unsigned long)wakeCurrent.totalMs());
+}
 
 // ───────── Kamera‑Pinout (AI‑Thinker ESP32‑CAM) ─────────
 #define PWDN_GPIO_NUM 32
@@ -75,8 +292,7 @@ static void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
 
 // ───────── Power Management Funktionen ─────────
 static void disablePeripherals() {
-  Serial.println(F("[Power] Deaktiviere Peripherie..."));
-  Serial.flush(); // Sicherstellen dass Output gesendet wird
+  ECO_LOGD("[Power] Deaktiviere Peripherie...");
   
   // Bluetooth sicher deaktivieren
   if (bt_initialized) {
@@ -84,16 +300,13 @@ static void disablePeripherals() {
     if (bt_err == ESP_OK) {
       esp_bt_mem_release(ESP_BT_MODE_BTDM);
       bt_initialized = false;
-      Serial.println(F("[Power] Bluetooth deaktiviert"));
-      Serial.flush();
+      ECO_LOGD("[Power] Bluetooth deaktiviert");
     } else {
-      Serial.printf("[Power] BT Deinit Fehler: %s\n", esp_err_to_name(bt_err));
-      Serial.flush();
+      ECO_LOGE("[Power] BT Deinit Fehler: %s", esp_err_to_name(bt_err));
     }
   }
   
-  Serial.println(F("[Power] Peripherie deaktiviert"));
-  Serial.flush();
+  ECO_LOGD("[Power] Peripherie deaktiviert");
 }
 
 static String getEspIdString() {
@@ -125,9 +338,9 @@ static void enableLowPowerMode() {
 // ───────── Hilfsfunktionen ─────────
 static void printWakeReason() {
   switch (esp_sleep_get_wakeup_cause()) {
-    case ESP_SLEEP_WAKEUP_TIMER:  Serial.println(F("[Wake] Timer")); break;
-    case ESP_SLEEP_WAKEUP_EXT0:   Serial.println(F("[Wake] PIR"));   break;
-    default:                      Serial.println(F("[Wake] Power‑On"));
+    case ESP_SLEEP_WAKEUP_TIMER:  ECO_LOGI("[Wake] Timer"); break;
+    case ESP_SLEEP_WAKEUP_EXT0:   ECO_LOGI("[Wake] PIR");   break;
+    default:                      ECO_LOGI("[Wake] Power‑On");
   }
 }
 
@@ -150,13 +363,222 @@ static float readVBat() {
   
   // ADC nicht sofort deaktivieren - wird in disablePeripherals() gemacht
   
-  Serial.printf("[Power] ADC Rohwert: %u, Spannung: %.3fV\n", raw, v_adc);
+  ECO_LOGD("[Power] ADC Rohwert: %u, Spannung: %.3fV", raw, v_adc);
   
   return v_adc;
 }
 
-static bool initCamera() {
-  Serial.println(F("[Cam] Initialisierung..."));
+// ───────── Belichtung (AEC/AGC) ─────────
+#ifndef AE_MAX_WARMUP_FRAMES
+#define AE_MAX_WARMUP_FRAMES 10  // Max. verworfene Bilder bis zur stabilen Belichtung
+#endif
+#ifndef AE_TOLERANCE_PCT
+#define AE_TOLERANCE_PCT 5       // Erlaubte Änderung der Gesamtbelichtung zwischen zwei Bildern
+#endif
+
+// OV2640 Sensor-Register (Bank 1, daher 0x100 für get_reg)
+#define OV2640_SENSOR_GAIN  0x100
+#define OV2640_SENSOR_REG04 0x104 // AEC[1:0]
+#define OV2640_SENSOR_AEC   0x110 // AEC[9:2]
+#define OV2640_SENSOR_REG45 0x145 // AEC[15:10]
+
+// Gain-Tabelle des esp32-camera Treibers (Index für set_agc_gain -> Registerwert)
+static const uint8_t agc_gain_tbl[31] = {
+  0x00, 0x10, 0x18, 0x30, 0x34, 0x38, 0x3C, 0x70, 0x72, 0x74, 0x76, 0x78, 0x7A, 0x7C, 0x7E, 0xF0,
+  0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF
+};
+
+// Eingeschwungene Belichtung des letzten Weckens
+struct AeRtcCache {
+  bool     valid;
+  uint16_t aec;      // Belichtungszeit in Zeilen
+  uint8_t  gainIdx;  // Index in agc_gain_tbl
+};
+RTC_DATA_ATTR AeRtcCache aeCache = {};
+
+// Verstärkung x16: jedes gesetzte Bit 7..4 verdoppelt, Bits 3..0 = 1/16-Schritte
+static uint32_t agcGainX16(uint8_t reg) {
+  return (16u + (reg & 0x0F)) << __builtin_popcount(reg >> 4);
+}
+
+static uint8_t agcGainIndex(uint8_t reg) {
+  uint32_t target = agcGainX16(reg);
+  uint8_t best = 0;
+  for (uint8_t i = 1; i < sizeof(agc_gain_tbl); ++i) {
+    uint32_t g = agcGainX16(agc_gain_tbl[i]);
+    uint32_t gb = agcGainX16(agc_gain_tbl[best]);
+    if ((g > target ? g - target : target - g) < (gb > target ? gb - target : target - gb)) best = i;
+  }
+  return best;
+}
+
+static uint16_t readAec(sensor_t* s) {
+  return ((s->get_reg(s, OV2640_SENSOR_REG45, 0x3F) << 10) |
+          (s->get_reg(s, OV2640_SENSOR_AEC, 0xFF) << 2) |
+          s->get_reg(s, OV2640_SENSOR_REG04, 0x03));
+}
+
+// Startwerte für AEC/AGC aus dem letzten Wecken setzen; die Automatik regelt
+// anschließend von dort aus weiter statt vom Standardwert.
+static void seedExposure(sensor_t* s) {
+  if (!aeCache.valid || s->id.PID != OV2640_PID) return;
+  s->set_exposure_ctrl(s, 0);
+  s->set_gain_ctrl(s, 0);
+  s->set_aec_value(s, aeCache.aec);
+  s->set_agc_gain(s, aeCache.gainIdx);
+  s->set_exposure_ctrl(s, 1);
+  s->set_gain_ctrl(s, 1);
+  ECO_LOGI("[Cam] Belichtung aus RTC vorbelegt (AEC %u, Gain-Index %u)",
+                aeCache.aec, aeCache.gainIdx);
+}
+
+// ───────── Bitraten-Regelung (JPEG-Qualität/Auflösung) ─────────
+#ifndef RATE_CONTROL
+#define RATE_CONTROL 1                   // Qualität/Auflösung nach Bytebudget wählen
+#endif
+#ifndef RATE_BUDGET_ESPNOW
+#define RATE_BUDGET_ESPNOW 40000         // Zielgröße pro Bild bei ESP-NOW (Bytes)
+#endif
+#ifndef RATE_BUDGET_HTTP
+#define RATE_BUDGET_HTTP 80000           // Zielgröße pro Bild bei HTTP (Bytes)
+#endif
+#ifndef RATE_QUALITY_BEST
+#define RATE_QUALITY_BEST 10             // jpeg_quality 0-63, kleiner = besser und größer
+#endif
+#ifndef RATE_QUALITY_WORST
+#define RATE_QUALITY_WORST 30
+#endif
+#ifndef RATE_FRAMESIZE_MAX
+#define RATE_FRAMESIZE_MAX FRAMESIZE_SVGA
+#endif
+#ifndef RATE_FRAMESIZE_MIN
+#define RATE_FRAMESIZE_MIN FRAMESIZE_VGA // mind. QVGA: die 1/8-Vorschau der Änderungserkennung braucht >= 32x24, also >= 256x192
+#endif
+#ifndef RATE_HISTORY
+#define RATE_HISTORY 4                   // Gemerkte Bildgrößen im RTC-Speicher
+#endif
+#define RATE_DEFAULT_QUALITY 12          // Ohne Verlauf bzw. bei RATE_CONTROL 0
+
+#if USE_ESP_NOW
+#define RATE_BUDGET RATE_BUDGET_ESPNOW
+#else
+#define RATE_BUDGET RATE_BUDGET_HTTP
+#endif
+
+// 4:3-Auflösungen von groß nach klein
+static const framesize_t rateFrameSizes[] = {
+  FRAMESIZE_UXGA, FRAMESIZE_SXGA, FRAMESIZE_XGA, FRAMESIZE_SVGA, FRAMESIZE_VGA, FRAMESIZE_QVGA
+};
+
+struct RateSample {
+  uint32_t len;
+  uint8_t  quality;
+  uint8_t  frameSize;
+};
+
+// Letzte Bildgrößen mit ihren Einstellungen und die Einstellung dieses Weckens
+struct RateRtcState {
+  uint8_t    count;
+  uint8_t    next;
+  uint8_t    quality;
+  uint8_t    frameSize;
+  uint16_t   recaptures;
+  RateSample samples[RATE_HISTORY];
+};
+RTC_DATA_ATTR RateRtcState rateState = {};
+
+// Modell: Bytes ≈ Komplexität x Pixel / Qualität. Die Komplexität (x256) hängt
+// nur vom Motiv ab und lässt sich so zwischen Einstellungen umrechnen.
+static uint32_t rateComplexity(uint32_t len, uint8_t quality, uint8_t frameSize) {
+  uint32_t pixels = (uint32_t)resolution[frameSize].width * resolution[frameSize].height;
+  return (uint64_t)len * quality * 256 / pixels;
+}
+
+// Schätzung für das nächste Bild: Mittel des Verlaufs, aber mindestens das
+// letzte Bild, damit ein plötzlich aufwendiges Motiv (Nacht, Rauschen) sofort zählt.
+static uint32_t rateEstimate() {
+  uint64_t sum = 0;
+  for (uint8_t i = 0; i < rateState.count; ++i) {
+    const RateSample& s = rateState.samples[i];
+    sum += rateComplexity(s.len, s.quality, s.frameSize);
+  }
+  const RateSample& last = rateState.samples[(rateState.next + RATE_HISTORY - 1) % RATE_HISTORY];
+  return max<uint32_t>(sum / rateState.count, rateComplexity(last.len, last.quality, last.frameSize));
+}
+
+// Größte Auflösung, bei der das Budget (mit 10 % Reserve) mit mittlerer Qualität
+// erreichbar ist; reicht auch die kleinste nicht, wird dort die Qualität weiter gesenkt.
+static void rateChoose(uint32_t complexity, uint8_t& quality, uint8_t& frameSize) {
+  const uint64_t target = (uint64_t)RATE_BUDGET * 9 / 10 * 256;
+  const uint8_t knee = (RATE_QUALITY_BEST + RATE_QUALITY_WORST) / 2;
+  for (framesize_t fs : rateFrameSizes) {
+    if (fs > RATE_FRAMESIZE_MAX || fs < RATE_FRAMESIZE_MIN) continue;
+    uint32_t pixels = (uint32_t)resolution[fs].width * resolution[fs].height;
+    uint32_t q = ((uint64_t)complexity * pixels + target - 1) / target;
+    q = max<uint32_t>(q, RATE_QUALITY_BEST);
+    quality = min<uint32_t>(q, RATE_QUALITY_WORST);
+    frameSize = fs;
+    if (q <= knee) return;
+  }
+}
+
+static void rateRecord(uint32_t len) {
+  rateState.samples[rateState.next] = { len, rateState.quality, rateState.frameSize };
+  rateState.next = (rateState.next + 1) % RATE_HISTORY;
+  if (rateState.count < RATE_HISTORY) ++rateState.count;
+}
+
+// Einstellung für dieses Wecken aus dem Verlauf (vor initCamera)
+static void ratePlan() {
+  rateState.quality = RATE_DEFAULT_QUALITY;
+  rateState.frameSize = RATE_FRAMESIZE_MAX;
+  if (!RATE_CONTROL || rateState.count == 0) return;
+  uint32_t complexity = rateEstimate();
+  rateChoose(complexity, rateState.quality, rateState.frameSize);
+  ECO_LOGI("[Rate] Qualität %u, %ux%u (Komplexität %u, Budget %u Bytes)",
+                rateState.quality, resolution[rateState.frameSize].width,
+                resolution[rateState.frameSize].height, complexity, RATE_BUDGET);
+}
+
+// Liegt das Bild über dem Budget, einmal mit den aus diesem Bild berechneten
+// Einstellungen neu aufnehmen, statt ein zu großes Bild zu senden.
+static camera_fb_t* rateEnforce(camera_fb_t* fb) {
+  rateRecord(fb->len);
+  sensor_t* s = esp_camera_sensor_get();
+  if (!RATE_CONTROL || fb->len <= RATE_BUDGET || s == NULL) return fb;
+
+  uint8_t quality = rateState.quality, frameSize = rateState.frameSize;
+  rateChoose(rateComplexity(fb->len, quality, frameSize), quality, frameSize);
+  if (quality == rateState.quality && frameSize == rateState.frameSize) {
+    ECO_LOGW("[Rate] Bild %u Bytes über Budget, bereits kleinste Einstellung", fb->len);
+    return fb;
+  }
+  ECO_LOGW("[Rate] Bild %u Bytes über Budget %u, neue Aufnahme mit Qualität %u, %ux%u",
+                fb->len, RATE_BUDGET, quality, resolution[frameSize].width, resolution[frameSize].height);
+  esp_camera_fb_return(fb);
+  s->set_quality(s, quality);
+  if (frameSize != rateState.frameSize) s->set_framesize(s, (framesize_t)frameSize);
+  rateState.quality = quality;
+  rateState.frameSize = frameSize;
+  ++rateState.recaptures;
+
+  // Das nächste Bild kann noch mit den alten Einstellungen entstanden sein
+  fb = esp_camera_fb_get();
+  if (fb) esp_camera_fb_return(fb);
+  fb = esp_camera_fb_get();
+  if (fb == NULL) {
+    ECO_LOGE("[Rate] Neue Aufnahme fehlgeschlagen");
+    return NULL;
+  }
+  ECO_LOGI("[Rate] Neue Aufnahme: %u Bytes (%u Wiederholungen seit Start)",
+                fb->len, rateState.recaptures);
+  rateRecord(fb->len);
+  return fb;
+}
+
+// fbCount 2: der Sensor nimmt weiter auf, während ein Bild kopiert bzw. gesendet wird
+static bool initCamera(framesize_t frameSize, uint8_t quality, uint8_t fbCount) {
+  ECO_LOGI("[Cam] Initialisierung...");
   
   camera_config_t cfg{};
   cfg.ledc_channel = LEDC_CHANNEL_0;
@@ -169,21 +591,21 @@ static bool initCamera() {
   cfg.pin_pwdn = PWDN_GPIO_NUM; cfg.pin_reset = RESET_GPIO_NUM;
   
   cfg.xclk_freq_hz = 10000000;          // Reduziert von 20MHz auf 10MHz (spart Strom)
-  cfg.frame_size   = FRAMESIZE_SVGA;
+  cfg.frame_size   = frameSize;
   cfg.pixel_format = PIXFORMAT_JPEG;
-  cfg.jpeg_quality = 12;                // Leicht erhöht für bessere Kompression
-  cfg.fb_count     = 1;
+  cfg.jpeg_quality = quality;
+  cfg.fb_count     = fbCount;
   cfg.fb_location  = CAMERA_FB_IN_PSRAM; // PSRAM nutzen falls verfügbar
   cfg.grab_mode    = CAMERA_GRAB_LATEST; // Neuestes Frame nehmen
 
   esp_err_t err = esp_camera_init(&cfg);
   if (err != ESP_OK) {
-    Serial.printf("[Cam] Init Fehler: %s\n", esp_err_to_name(err));
+    ECO_LOGE("[Cam] Init Fehler: %s", esp_err_to_name(err));
     return false;
   }
   
   camera_initialized = true;
-  Serial.println(F("[Cam] Initialisierung erfolgreich"));
+  ECO_LOGI("[Cam] Initialisierung erfolgreich");
   
   // Standard Kameraeinstellungen (Automatik)
   sensor_t *s = esp_camera_sensor_get();
@@ -206,150 +628,781 @@ static bool initCamera() {
     s->set_bpc(s, 1);           // Black pixel cancel EIN
     s->set_wpc(s, 1);           // White pixel cancel EIN
     s->set_raw_gma(s, 1);       // Gamma correction EIN
-    Serial.println(F("[Cam] Standard-Kameraeinstellungen (Automatik) gesetzt."));
+    ECO_LOGI("[Cam] Standard-Kameraeinstellungen (Automatik) gesetzt.");
+    seedExposure(s);
   }
   
   return true;
 }
 
+// Nimmt Bilder auf, bis Belichtung (AEC) und Verstärkung (AGC) stabil sind, und
+// liefert das erste stabile Bild (Aufrufer gibt es mit esp_camera_fb_return frei).
+// Der eingeschwungene Wert wird für das nächste Wecken im RTC-Speicher gemerkt.
+static camera_fb_t* captureSettled() {
+  sensor_t* s = esp_camera_sensor_get();
+  bool useRegs = s != NULL && s->id.PID == OV2640_PID;
+  uint32_t prev = 0;
+  bool havePrev = false;
+  if (useRegs && aeCache.valid) {
+    prev = (uint32_t)aeCache.aec * agcGainX16(agc_gain_tbl[aeCache.gainIdx]);
+    havePrev = true; // vorbelegter Wert dient als Referenz für das erste Bild
+  }
+
+  for (int frame = 0; frame <= AE_MAX_WARMUP_FRAMES; ++frame) {
+    camera_fb_t* fb = esp_camera_fb_get();
+    if (!fb) {
+      ECO_LOGE("[Cam] Aufnahme %d fehlgeschlagen", frame + 1);
+      return NULL;
+    }
+    // Gesamtbelichtung = Belichtungszeit x Verstärkung; ohne OV2640-Register dient
+    // die JPEG-Größe als Näherung für die Bildhelligkeit.
+    uint16_t aec = 0;
+    uint8_t gain = 0;
+    uint32_t cur;
+    if (useRegs) {
+      aec = readAec(s);
+      gain = s->get_reg(s, OV2640_SENSOR_GAIN, 0xFF);
+      cur = (uint32_t)aec * agcGainX16(gain);
+    } else {
+      cur = fb->len;
+    }
+
+    uint32_t tol = prev * AE_TOLERANCE_PCT / 100;
+    bool stable = havePrev && (cur > prev ? cur - prev : prev - cur) <= max<uint32_t>(tol, 1);
+    if (stable || frame == AE_MAX_WARMUP_FRAMES) {
+      if (stable) {
+        ECO_LOGI("[Cam] Belichtung stabil nach %d Vorlauf-Bildern (AEC %u, Gain 0x%02X)",
+                      frame, aec, gain);
+      } else {
+        ECO_LOGW("[Cam] Belichtung nach %d Bildern nicht stabil, nehme letztes Bild", frame + 1);
+      }
+      if (useRegs) {
+        aeCache.aec = aec;
+        aeCache.gainIdx = agcGainIndex(gain);
+        aeCache.valid = true;
+      }
+      return fb;
+    }
+    esp_camera_fb_return(fb);
+    prev = cur;
+    havePrev = true;
+  }
+  return NULL;
+}
+
+// ───────── WiFi Schnellverbindung ─────────
+// BSSID, Kanal und zuletzt per DHCP erhaltene IP-Konfiguration werden im
+// RTC-Speicher gehalten. Beim nächsten Wecken wird damit ohne Kanal-Scan und
+// ohne DHCP verbunden; schlägt das fehl, folgt eine normale Verbindung.
+#ifndef WIFI_FAST_CONNECT
+#define WIFI_FAST_CONNECT 1            // 0 = immer vollständiger Scan + DHCP
+#endif
+#ifndef WIFI_FAST_TIMEOUT_MS
+#define WIFI_FAST_TIMEOUT_MS 3000      // Max. Dauer des Schnellverbindungsversuchs
+#endif
+#ifndef WIFI_CONNECT_TIMEOUT_MS
+#define WIFI_CONNECT_TIMEOUT_MS 10000  // Max. Dauer der normalen Verbindung
+#endif
+
+struct WifiRtcCache {
+  uint32_t magic;      // WIFI_CACHE_MAGIC wenn gültig
+  uint32_t ssidHash;   // erkennt geänderte Zugangsdaten
+  uint8_t  bssid[6];
+  uint8_t  channel;
+  uint32_t ip, gateway, subnet, dns;
+};
+static const uint32_t WIFI_CACHE_MAGIC = 0x57494649; // "WIFI"
+RTC_DATA_ATTR WifiRtcCache wifiCache = {};
+static uint32_t wifiConnectMs = 0;  // Verbindungsdauer dieses Weckzyklus
+static bool wifiFastUsed = false;
+
+static uint32_t ssidHash() {
+  uint32_t h = 2166136261u; // FNV-1a
+  for (const char* c = ssid; *c; ++c) h = (h ^ (uint8_t)*c) * 16777619u;
+  for (const char* c = password; *c; ++c) h = (h ^ (uint8_t)*c) * 16777619u;
+  return h;
+}
+
+static bool waitForWifi(uint32_t t0, uint32_t timeoutMs) {
+  while (WiFi.status() != WL_CONNECTED && millis() - t0 < timeoutMs) {
+    delay(10);
+  }
+  return WiFi.status() == WL_CONNECTED;
+}
+
 static bool wifiConnect() {
+  uint32_t t0 = millis();
+  WiFi.persistent(false); // Zugangsdaten nicht bei jedem Wecken in den Flash schreiben
+  WiFi.mode(WIFI_STA);
   // WiFi Power Management vor Connect setzen
   esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
-  
-  WiFi.begin(ssid, password);
-  Serial.print(F("Wi‑Fi"));
-  for (uint32_t t0 = millis(); WiFi.status()!=WL_CONNECTED && millis()-t0<10000; ) {
-    delay(250); Serial.print('.');
+
+  bool connected = false;
+  wifiFastUsed = false;
+#if WIFI_FAST_CONNECT
+  if (wifiCache.magic == WIFI_CACHE_MAGIC && wifiCache.ssidHash == ssidHash()) {
+    wifiFastUsed = true;
+    WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway),
+                IPAddress(wifiCache.subnet), IPAddress(wifiCache.dns));
+    WiFi.begin(ssid, password, wifiCache.channel, wifiCache.bssid);
+    connected = waitForWifi(t0, WIFI_FAST_TIMEOUT_MS);
+    if (!connected) {
+      ECO_LOGW("[WiFi] Schnellverbindung fehlgeschlagen, starte Scan + DHCP");
+      wifiCache.magic = 0;
+      WiFi.disconnect();
+      WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0)); // DHCP wieder aktivieren
+    }
   }
-  Serial.println();
-  return WiFi.status() == WL_CONNECTED;
+#endif
+  if (!connected) {
+    wifiFastUsed = false;
+    WiFi.begin(ssid, password);
+    connected = waitForWifi(millis(), WIFI_CONNECT_TIMEOUT_MS);
+  }
+  wifiConnectMs = millis() - t0;
+
+  if (!connected) {
+    ECO_LOGE("[WiFi] Keine Verbindung nach %lu ms", (unsigned long)wifiConnectMs);
+    return false;
+  }
+  ECO_LOGI("[WiFi] Verbunden in %lu ms (%s, Kanal %d, IP %s)", (unsigned long)wifiConnectMs,
+                wifiFastUsed ? "Schnellverbindung" : "Scan + DHCP",
+                WiFi.channel(), WiFi.localIP().toString().c_str());
+
+  if (!wifiFastUsed) {
+    // Neue Verbindungsdaten für das nächste Wecken merken
+    memcpy(wifiCache.bssid, WiFi.BSSID(), sizeof(wifiCache.bssid));
+    wifiCache.channel  = WiFi.channel();
+    wifiCache.ip       = WiFi.localIP();
+    wifiCache.gateway  = WiFi.gatewayIP();
+    wifiCache.subnet   = WiFi.subnetMask();
+    wifiCache.dns      = WiFi.dnsIP();
+    wifiCache.ssidHash = ssidHash();
+    wifiCache.magic    = WIFI_CACHE_MAGIC;
+  }
+  return true;
+}
+
+#if !USE_ESP_NOW
+// Verbindungsaufbau in eigenem Task, damit Kamera-Init und Belichtungsanpassung
+// parallel laufen. Das Ergebnis wird per Task-Notification an setup() gemeldet.
+static TaskHandle_t wifiWaiter = nullptr;
+
+static void wifiConnectTask(void*) {
+  bool ok = wifiConnect();
+  xTaskNotify(wifiWaiter, ok ? 1 : 2, eSetValueWithOverwrite);
+  vTaskDelete(nullptr);
+}
+
+static void startWifiConnect() {
+  wifiWaiter = xTaskGetCurrentTaskHandle();
+  xTaskCreatePinnedToCore(wifiConnectTask, "wifi_conn", 4096, nullptr, 2, nullptr, 0);
 }
 
+// Wartet auf das Ergebnis von startWifiConnect(); true wenn verbunden
+static bool waitWifiConnect() {
+  uint32_t result = 0;
+  TickType_t timeout = pdMS_TO_TICKS(WIFI_FAST_TIMEOUT_MS + WIFI_CONNECT_TIMEOUT_MS + 1000);
+  if (xTaskNotifyWait(0, UINT32_MAX, &result, timeout) != pdTRUE) return false;
+  return result == 1;
+}
+#endif
+
 #if USE_ESP_NOW
 static bool initEspNow() {
   WiFi.mode(WIFI_STA);
   esp_wifi_set_ps(WIFI_PS_MAX_MODEM); // Power Save auch für ESP-NOW
+  linkApply();
 
   if (esp_now_init() != ESP_OK) {
-    Serial.println(F("[ESP-NOW] Fehler bei der Initialisierung"));
+    ECO_LOGE("[ESP-NOW] Fehler bei der Initialisierung");
     return false;
   }
   esp_now_register_send_cb(OnDataSent);
+  esp_now_register_recv_cb(OnDataRecv);
 
   memcpy(peerInfo.peer_addr, espNowReceiverMac, 6);
   peerInfo.channel = ESP_NOW_CHANNEL; 
   peerInfo.encrypt = false;
 
   if (esp_now_add_peer(&peerInfo) != ESP_OK) {
-    Serial.println(F("[ESP-NOW] Fehler beim Hinzufügen des Peers"));
+    ECO_LOGE("[ESP-NOW] Fehler beim Hinzufügen des Peers");
     esp_now_deinit();
     return false;
   }
-  Serial.println(F("[ESP-NOW] Initialisierung erfolgreich, Peer hinzugefügt."));
+  ECO_LOGI("[ESP-NOW] Initialisierung erfolgreich, Peer hinzugefügt.");
   return true;
 }
 
+// Überträgt ein Bild per Sliding Window mit anschließenden NACK-Runden
+// (EspNowSender); hier nur Versionswahl, Profil und Auswertung.
 static bool sendJpegEspNow(uint8_t* buf, size_t len, uint32_t imageId, uint16_t v_bat_mv) {
   if (len == 0) {
-    Serial.println(F("[ESP-NOW] Keine Daten zum Senden."));
+    ECO_LOGE("[ESP-NOW] Keine Daten zum Senden.");
     return false;
   }
 
-  if (len > 50000) {
-    Serial.printf("[ESP-NOW] Bild zu groß für ESP-NOW: %u Bytes. Maximum: 50KB\n", len);
+  // Version und Paketgröße: eigenes Maximum, begrenzt durch die Fähigkeiten des Empfängers
+  uint8_t version = min<uint8_t>(ESP_NOW_PROTOCOL_VERSION, espNowPeerVersion);
+  uint16_t maxPayload = min<uint16_t>(ESP_NOW_MAX_PAYLOAD_LARGE, espNowPeerMaxPayload);
+
+  // Wachzeit-Profil als Header-Erweiterung in Chunk 0 (nur v2)
+  WakeProfile profile;
+  uint8_t ext[WAKE_PROFILE_EXT_SIZE];
+  uint8_t extLen = profileToSend(profile) ? wakeProfilePack(profile, ext) : 0;
+
+  // FEC nur, wenn der Empfänger Paritäten auswerten kann
+  uint8_t fecM = 0;
+#if ESP_NOW_FEC
+  if (version >= ESP_NOW_PROTOCOL_V2 && (espNowPeerFeatures & ESP_NOW_CAPS_FEATURE_FEC)) fecM = fecParity();
+#endif
+
+  EspNowTxImage img;
+  if (!espNowTxImageInit(img, buf, len, imageId, v_bat_mv, version, maxPayload,
+                         ESP_NOW_CHUNK_CRC, ESP_NOW_FLAG_WAKE_PROFILE, ext, extLen, ESP_NOW_FEC_K, fecM)) {
+    ECO_LOGE("[ESP-NOW] Bild zu groß für ESP-NOW: %u Bytes (max. %u Pakete)",
+                  len, ESP_NOW_MAX_CHUNKS);
     return false;
   }
+  uint16_t totalChunks = img.total_chunks;
 
-  esp_now_image_chunk_t chunk_message;
-  chunk_message.image_id = imageId;
-  chunk_message.total_size = len;
-  chunk_message.vbat_mv_high = (v_bat_mv >> 8) & 0xFF;
-  chunk_message.vbat_mv_low = v_bat_mv & 0xFF;
+  ECO_LOGI("[ESP-NOW] Sende Bild (ID: %u, Größe: %u Bytes, Chunks: %u x %u, Protokoll v%u, Fenster: %u, FEC %u+%u)",
+                imageId, len, totalChunks, img.chunk_size, version, ESP_NOW_WINDOW_SIZE, img.fec_k, img.fec_m);
 
-  uint16_t totalChunks = (len + ESP_NOW_MAX_DATA_PER_CHUNK - 1) / ESP_NOW_MAX_DATA_PER_CHUNK;
-  chunk_message.total_chunks = totalChunks;
+  EspNowSender::Stats stats;
+  unsigned long tStart = millis();
+  // Ohne Bericht zu dieser Übertragung (Abbruch, alter Empfänger) beim nächsten Wecken robust starten
+  linkState.reportValid = false;
+  EspNowSender::Result result = espNowSender.send(espNowReceiverMac, img, stats);
 
-  Serial.printf("[ESP-NOW] Sende Bild (ID: %u, Größe: %u Bytes, Chunks: %u)\n", 
-                imageId, len, totalChunks);
+  switch (result) {
+    case EspNowSender::ACKED:
+      ECO_LOGI("[ESP-NOW] Empfänger bestätigt vollständiges Bild");
+      break;
+    case EspNowSender::NO_RESPONSE:
+      // Kein NACK/ACK: Empfänger ohne NACK-Unterstützung, MAC-ACKs gelten als Erfolg
+      ECO_LOGW("[ESP-NOW] Keine Rückmeldung vom Empfänger, MAC-ACKs gelten als Bestätigung");
+      // v2-Empfänger antworten immer; ohne Antwort beim nächsten Bild wieder mit v1 beginnen
+      espNowPeerVersion = ESP_NOW_PROTOCOL_V1;
+      espNowPeerMaxPayload = ESP_NOW_MAX_PAYLOAD;
+      espNowPeerFeatures = 0;
+      break;
+    case EspNowSender::SEND_ERROR:
+      ECO_LOGE("[ESP-NOW] Fehler bei Paket %u: %s",
+                    stats.failedChunk + 1, esp_err_to_name(stats.error));
+      return false;
+    case EspNowSender::CHUNK_FAILED:
+      ECO_LOGE("[ESP-NOW] Paket %u/%u nach %u Versuchen nicht zugestellt",
+                    stats.failedChunk + 1, img.total_packets, ESP_NOW_MAX_RETRIES_PER_CHUNK + 1);
+      return false;
+    case EspNowSender::STALLED:
+      ECO_LOGE("[ESP-NOW] Timeout, %u/%u Chunks bestätigt", stats.ackedChunks, totalChunks);
+      return false;
+    case EspNowSender::INCOMPLETE:
+      ECO_LOGE("[ESP-NOW] Bild nach %u NACK-Runden unvollständig (%u/%u Chunks)",
+                    stats.nackRounds, stats.receivedChunks, totalChunks);
+      return false;
+  }
 
-  for (uint16_t i = 0; i < totalChunks; ++i) {
-    chunk_message.chunk_index = i;
-    size_t offset = i * ESP_NOW_MAX_DATA_PER_CHUNK;
-    size_t currentChunkDataSize = (i == totalChunks - 1) ? 
-                                  (len - offset) : ESP_NOW_MAX_DATA_PER_CHUNK;
-    chunk_message.data_len = currentChunkDataSize;
-    memcpy(chunk_message.data, buf + offset, currentChunkDataSize);
+  ECO_LOGI("[ESP-NOW] Übertragung komplett: %lu ms, %u Sendungen, %u Wiederholungen, %u per FEC abgedeckt, %u NACK-Runden",
+                millis() - tStart, stats.sent, stats.retransmissions, stats.fecCovered, stats.nackRounds);
+  ECO_LOGI("[ESP-NOW] ACK-Latenz je Chunk: Mittel %lu us, max. %lu us, Reaktion %lu us",
+           (unsigned long)stats.ackLatencyAvgUs, (unsigned long)stats.ackLatencyMaxUs,
+           (unsigned long)stats.wakeLatencyAvgUs);
+  return true;
+}
+#endif
 
-    espNowSendSuccess = false;
+// Eine TCP-Verbindung für alle Uploads eines Weckzyklus (HTTP/1.1 Keep-Alive)
+static WiFiClient uploadClient;
+static HTTPClient http;
 
-    size_t messageSize = offsetof(esp_now_image_chunk_t, data) + currentChunkDataSize;
-    esp_err_t result = esp_now_send(espNowReceiverMac, (uint8_t*)&chunk_message, messageSize);
+#ifndef HTTP_RESUMABLE_UPLOAD
+#define HTTP_RESUMABLE_UPLOAD 1       // Segmentierter, fortsetzbarer Upload (benötigt aktuelles upload.php)
+#endif
+#ifndef UPLOAD_SEGMENT_SIZE
+#define UPLOAD_SEGMENT_SIZE 16384     // Bytes pro Segment (Content-Range)
+#endif
+#ifndef UPLOAD_RETRIES
+#define UPLOAD_RETRIES 3              // Wiederaufnahmen pro Bild innerhalb eines Weckzyklus
+#endif
 
-    if (result == ESP_OK) {
-      unsigned long startTime = millis();
-      while (!espNowSendSuccess && (millis() - startTime < 3000)) {
-        delay(10);
-      }
+static const char* uploadHeaderKeys[] = { "X-Upload-Offset" };
 
-      if (!espNowSendSuccess) {
-        Serial.printf("[ESP-NOW] Timeout bei Chunk %u/%u\n", i + 1, totalChunks);
-        return false; 
-      }
+// Sendet ein Segment [offset, offset + n) direkt aus buf. Liefert den HTTP-Code;
+// acked enthält den vom Server bestätigten Stand (-1 wenn nicht gemeldet).
+static int postSegment(const char* url, uint8_t* buf, size_t offset, size_t n, size_t total, long& acked) {
+  acked = -1;
+  if (!http.begin(uploadClient, url)) {
+    ECO_LOGE("http.begin() fehlgeschlagen");
+    return -1;
+  }
+  http.setReuse(true);
+  http.collectHeaders(uploadHeaderKeys, 1);
+  http.addHeader("Content-Type", "image/jpeg");
+  if (n > 0) {
+    char range[48];
+    snprintf(range, sizeof(range), "bytes %u-%u/%u", (unsigned)offset, (unsigned)(offset + n - 1), (unsigned)total);
+    http.addHeader("Content-Range", range);
+  }
+  http.setTimeout(8000); // Timeout reduziert
 
-      if (i < totalChunks - 1) {
-        delay(20);
-      }
-    } else {
-      Serial.printf("[ESP-NOW] Fehler bei Chunk %u: %s\n", 
-                    i + 1, esp_err_to_name(result));
-      return false; 
+  int rc = http.POST(buf + offset, n);
+  if (http.hasHeader("X-Upload-Offset")) acked = http.header("X-Upload-Offset").toInt();
+  if (rc > 0 && offset + n == total) ECO_LOGD("%s", http.getString().c_str());
+  http.end();
+  return rc;
+}
+
+// Lädt ein Bild in Segmenten hoch und setzt nach Abbrüchen beim zuletzt vom Server
+// bestätigten Offset fort. resume: erst den Stand beim Server abfragen (Bild aus
+// dem Zwischenspeicher, ein früherer Versuch kann bereits Teile übertragen haben).
+static bool sendJpeg(uint8_t* buf, size_t len, const char* url, bool resume) {
+#if HTTP_RESUMABLE_UPLOAD
+  ECO_LOGD("Sende %u Bytes an: %s", len, url);
+  size_t offset = 0;
+  long acked;
+  if (resume) {
+    char statusUrl[416];
+    snprintf(statusUrl, sizeof(statusUrl), "%s&status=1", url);
+    postSegment(statusUrl, buf, 0, 0, len, acked);
+    if (acked > 0 && (size_t)acked <= len) {
+      offset = acked;
+      ECO_LOGI("[Upload] Setze bei %u/%u Bytes fort", offset, len);
     }
   }
 
-  Serial.println(F("[ESP-NOW] Übertragung komplett"));
+  uint8_t failures = 0;
+  int rc = 0;
+  while (offset < len) {
+    size_t n = min<size_t>(len - offset, UPLOAD_SEGMENT_SIZE);
+    rc = postSegment(url, buf, offset, n, len, acked);
+    // 409: Server hat einen anderen Stand gemeldet, dort weitermachen
+    bool answered = (rc >= 200 && rc < 300) || rc == 409;
+    if (answered && acked >= 0 && (size_t)acked <= len) {
+      bool progress = (size_t)acked > offset;
+      if (!progress) {
+        // Stand bewegt sich nicht (z.B. Server kann nicht schreiben): zählt als Fehlversuch,
+        // sonst pendeln Sender und Server im Weckzyklus endlos zwischen zwei Offsets
+        ECO_LOGW("[Upload] Kein Fortschritt: Server meldet %ld statt > %u Bytes (HTTP %d)", acked, offset, rc);
+      }
+      offset = acked;
+      if (!progress && ++failures > UPLOAD_RETRIES) return false;
+      continue;
+    }
+    if (rc >= 200 && rc < 300) { // Server ohne Offset-Header
+      offset += n;
+      continue;
+    }
+    ECO_LOGE("[Upload] Segment ab %u fehlgeschlagen: HTTP rc=%d (%s)",
+                  offset, rc, http.errorToString(rc).c_str());
+    if (++failures > UPLOAD_RETRIES) return false;
+    uploadClient.stop(); // neue Verbindung, Fortsetzung ab dem bestätigten Offset
+    delay(200);
+  }
+  ECO_LOGI("HTTP rc=%d, %u Bytes bestätigt", rc, len);
   return true;
-}
-#endif
-
-static bool sendJpeg(uint8_t* buf, size_t len, const char* url) {
-  HTTPClient http;
-  bool ok = http.begin(url);
+#else
+  bool ok = http.begin(uploadClient, url);
   if (!ok) { 
-    Serial.println(F("http.begin() fehlgeschlagen")); 
+    ECO_LOGE("http.begin() fehlgeschlagen"); 
     return false; 
   }
 
-  http.useHTTP10(true);
+  http.setReuse(true);
   http.addHeader("Content-Type", "image/jpeg");
   http.setTimeout(8000); // Timeout reduziert
   
-  Serial.printf("Sende %u Bytes an: %s\n", len, url);
+  ECO_LOGD("Sende %u Bytes an: %s", len, url);
   int rc = http.POST(buf, len);
-  Serial.printf("HTTP rc=%d (%s)\n", rc, http.errorToString(rc).c_str());
+  ECO_LOGI("HTTP rc=%d (%s)", rc, http.errorToString(rc).c_str());
   
-  if (rc > 0) Serial.println(http.getString());
+  if (rc > 0) ECO_LOGD("%s", http.getString().c_str());
   http.end();
   
   return rc >= 200 && rc < 300;
+#endif
 }
 
+// ───────── Zwischenspeicher (Store-and-Forward) ─────────
+#ifndef FRAME_QUEUE_MAX_FRAMES
+#define FRAME_QUEUE_MAX_FRAMES 20           // 0 = Zwischenspeicher deaktiviert
+#endif
+#ifndef FRAME_QUEUE_MAX_BYTES
+#define FRAME_QUEUE_MAX_BYTES (1024 * 1024) // Max. Belegung im LittleFS
+#endif
+
+static FrameQueue frameQueue(FRAME_QUEUE_MAX_FRAMES, FRAME_QUEUE_MAX_BYTES);
+
+// Sekunden seit Power-On; die RTC-Zeit läuft im Deep Sleep weiter
+static uint32_t rtcSeconds() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return tv.tv_sec;
+}
+
+// Millisekunden seit Power-On über alle Weckzyklen; eindeutige Bild-IDs
+static uint32_t rtcMillis() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (uint32_t)((uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000);
+}
+
+static QueuedFrameInfo makeFrameInfo(uint32_t imageId, uint16_t vbatMv) {
+  QueuedFrameInfo info = {};
+  info.image_id = imageId;
+  info.captured_s = rtcSeconds();
+  info.vbat_mv = vbatMv;
+  strncpy(info.esp_id, getEspIdString().c_str(), sizeof(info.esp_id) - 1);
+  strncpy(info.wake_reason, getWakeupReasonString().c_str(), sizeof(info.wake_reason) - 1);
+  return info;
+}
+
+#if !USE_ESP_NOW
+// Hängt "&prof=boot,vbat,...&prof_wake=n" an, solange das Profil noch nicht gesendet wurde
+static void appendProfileQuery(char* out, size_t size) {
+  WakeProfile p;
+  if (size == 0 || !profileToSend(p)) return;
+  int n = snprintf(out, size, "&prof_wake=%lu&prof=", (unsigned long)wakeHistory.wakes);
+  for (uint8_t i = 0; i < WAKE_PHASE_COUNT && n > 0 && (size_t)n < size; ++i) {
+    n += snprintf(out + n, size - n, i ? ",%u" : "%u", p.phase_ms[i]);
+  }
+}
+#endif
+
+// Sendet ein Bild über die bestehende Verbindung (HTTP oder ESP-NOW)
+// resume: Bild aus dem Zwischenspeicher, Upload ggf. beim Server fortsetzen
+static bool uploadFrame(uint8_t* buf, size_t len, const QueuedFrameInfo& info, bool resume) {
+#if USE_ESP_NOW
+  bool ok = sendJpegEspNow(buf, len, info.image_id, info.vbat_mv);
+#else
+  char url_buffer[400]; // Puffer vergrößert für zusätzliche Parameter
+  // upload_id = Kamera + Bild-ID, bleibt über Weckzyklen hinweg gleich. Nach einem Stromausfall
+  // beginnt rtcMillis() neu und IDs können sich wiederholen; die CRC trennt solche Bilder beim Server.
+  int n = snprintf(url_buffer, sizeof(url_buffer), "%s?vbat=%u&esp_id=%s&wake_reason=%s&wifi_ms=%lu&wifi_fast=%u&age_s=%lu&upload_id=%s-%08lX&crc=%08lX", 
+                   serverURL, info.vbat_mv, info.esp_id, info.wake_reason,
+                   (unsigned long)wifiConnectMs, wifiFastUsed ? 1 : 0,
+                   (unsigned long)(rtcSeconds() - info.captured_s),
+                   info.esp_id, (unsigned long)info.image_id, (unsigned long)espNowCrc32(0, buf, len));
+  appendProfileQuery(url_buffer + n, sizeof(url_buffer) - n);
+  bool ok = sendJpeg(buf, len, url_buffer, resume);
+#endif
+  if (ok) wakeProfileSent = true;
+  return ok;
+}
+
+// Bild für einen späteren Versuch im LittleFS ablegen
+static void deferFrame(const uint8_t* buf, size_t len, const QueuedFrameInfo& info) {
+  if (FRAME_QUEUE_MAX_FRAMES == 0 || !frameQueue.begin()) return;
+  frameQueue.push(buf, len, info);
+}
+
+// Gespeicherte Bilder (älteste zuerst) über die aktuelle Verbindung nachsenden
+static void drainFrameQueue() {
+  if (FRAME_QUEUE_MAX_FRAMES == 0 || !frameQueue.begin() || frameQueue.count() == 0) return;
+  uint16_t sent = 0;
+  unsigned long t0 = millis();
+  while (frameQueue.count() > 0) {
+    QueuedFrameInfo info;
+    uint8_t* buf = frameQueue.loadOldest(info);
+    if (buf == nullptr) {
+      ECO_LOGE("[Queue] Eintrag nicht lesbar, verworfen");
+      frameQueue.popOldest();
+      continue;
+    }
+    bool ok = uploadFrame(buf, info.len, info, true);
+    free(buf);
+    if (!ok) break; // Verbindung gestört, Rest beim nächsten Wecken
+    frameQueue.popOldest();
+    ++sent;
+  }
+  ECO_LOGI("[Queue] %u Bilder nachgesendet in %lu ms, %u verbleiben",
+                sent, millis() - t0, frameQueue.count());
+}
+
+// ───────── PIR-Serienaufnahme ─────────
+#ifndef PIR_BURST_FRAMES
+#define PIR_BURST_FRAMES 3        // Bilder pro PIR-Wecken (1 = Einzelbild)
+#endif
+#ifndef PIR_BURST_INTERVAL_MS
+#define PIR_BURST_INTERVAL_MS 0   // Pause zwischen Serienbildern (0 = Sensor-Bildrate)
+#endif
+
+// Eine Aufnahme: das letzte Bild bleibt im Framebuffer des Treibers, frühere
+// Bilder einer Serie werden in den PSRAM kopiert, um den Puffer freizugeben.
+struct CapturedFrame {
+  camera_fb_t*    fb;
+  uint8_t*        copy;
+  QueuedFrameInfo info;
+  uint8_t* data() const { return fb ? fb->buf : copy; }
+};
+
+static void releaseFrame(CapturedFrame& frame) {
+  if (frame.fb) esp_camera_fb_return(frame.fb);
+  free(frame.copy);
+  frame.fb = nullptr;
+  frame.copy = nullptr;
+}
+
+// Nimmt bis zu count Bilder auf (das erste nach eingeschwungener Belichtung);
+// liefert die Anzahl erfolgreicher Aufnahmen.
+static uint8_t captureFrames(CapturedFrame* frames, uint8_t count, uint32_t imageId, uint16_t vbatMv) {
+  uint8_t n = 0;
+  camera_fb_t* fb = captureSettled();
+  if (fb) fb = rateEnforce(fb);
+  unsigned long t0 = millis();
+  while (fb) {
+    frames[n].fb = fb;
+    frames[n].copy = nullptr;
+    frames[n].info = makeFrameInfo(imageId + n, vbatMv);
+    frames[n].info.len = fb->len;
+    if (++n >= count) break;
+
+    uint8_t* copy = (uint8_t*)ps_malloc(fb->len);
+    if (copy == nullptr) {
+      ECO_LOGW("[Cam] Kein PSRAM für weitere Serienbilder");
+      break;
+    }
+    memcpy(copy, fb->buf, fb->len);
+    esp_camera_fb_return(fb);
+    frames[n - 1].fb = nullptr;
+    frames[n - 1].copy = copy;
+#if PIR_BURST_INTERVAL_MS > 0
+    delay(PIR_BURST_INTERVAL_MS);
+#endif
+    fb = esp_camera_fb_get();
+  }
+  if (count > 1) {
+    ECO_LOGI("[Cam] Serie: %u/%u Bilder in %lu ms", n, count, millis() - t0);
+  }
+  return n;
+}
+
+// ───────── Live-Modus ─────────
+// Statt eines Einzelbilds pro Wecken nimmt die Kamera laufend in reduzierter Auflösung
+// auf und jedes Bild geht sofort per ESP-NOW an den Empfänger (z.B. zum Ausrichten der
+// Kamera). Eine Aufnahme-Task taktet die Bildrate und hält nur das neueste Bild bereit;
+// ist die Funkstrecke langsamer, wird das ältere, noch nicht gesendete Bild verworfen.
+// Gesendet wird mit kurzem Timeout und ohne NACK-Runden: statt Lücken nachzusenden,
+// ersetzt das nächste Bild ein unvollständiges.
+#if USE_ESP_NOW
+#ifndef LIVE_STREAM
+#define LIVE_STREAM 0                   // 1 = bei jedem Start streamen
+#endif
+#ifndef LIVE_STREAM_PIN
+#define LIVE_STREAM_PIN -1              // GPIO, beim Start auf GND gebrückt = Live-Modus (-1 = keiner)
+#endif
+#ifndef LIVE_FRAMESIZE
+#define LIVE_FRAMESIZE FRAMESIZE_QVGA   // passt ohne Skalierung auf das 320x240-Display des Empfängers
+#endif
+#ifndef LIVE_QUALITY
+#define LIVE_QUALITY 15
+#endif
+#ifndef LIVE_FPS
+#define LIVE_FPS 10                     // Ziel-Bildrate der Aufnahme
+#endif
+#ifndef LIVE_MAX_SECONDS
+#define LIVE_MAX_SECONDS 600            // danach Deep Sleep, weitere Wecken im normalen Betrieb (0 = unbegrenzt)
+#endif
+#ifndef LIVE_NACK_TIMEOUT_MS
+#define LIVE_NACK_TIMEOUT_MS 40         // Wartezeit auf die Bestätigung eines Bildes
+#endif
+#ifndef LIVE_MAX_FRAME_BYTES
+#define LIVE_MAX_FRAME_BYTES 32768      // Größere Bilder werden verworfen
+#endif
+
+static camera_fb_t* volatile livePending = nullptr; // neuestes, noch nicht gesendetes Bild
+static portMUX_TYPE liveMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t liveWaiter = nullptr;           // sendender Task, wird je Bild geweckt
+static volatile bool liveRunning = false;
+static volatile bool liveTaskDone = false;
+static volatile uint32_t liveCaptured = 0;
+static volatile uint32_t liveDropped = 0;
+
+// Nur nach dem Einschalten bzw. einem Reset, nie beim Wecken aus dem Deep Sleep: sonst
+// begänne jedes Timer- oder PIR-Wecken eine neue Live-Sitzung und der Sender fände nie
+// in den normalen Betrieb zurück
+static bool liveRequested() {
+  if (esp_reset_reason() == ESP_RST_DEEPSLEEP) return false;
+  if (LIVE_STREAM) return true;
+#if LIVE_STREAM_PIN >= 0
+  pinMode(LIVE_STREAM_PIN, INPUT_PULLUP);
+  delay(2); // Pull-up einschwingen lassen
+  return digitalRead(LIVE_STREAM_PIN) == LOW;
+#else
+  return false;
+#endif
+}
+
+// Taktet die Aufnahme auf LIVE_FPS. Ein nicht abgeholtes Bild geht sofort an den
+// Treiber zurück, damit immer ein Framebuffer für die nächste Aufnahme frei bleibt.
+static void liveCaptureTask(void*) {
+  const TickType_t period = pdMS_TO_TICKS(1000 / LIVE_FPS);
+  TickType_t next = xTaskGetTickCount();
+  while (liveRunning) {
+    camera_fb_t* fb = esp_camera_fb_get();
+    if (fb) {
+      portENTER_CRITICAL(&liveMux);
+      camera_fb_t* old = livePending;
+      livePending = fb;
+      portEXIT_CRITICAL(&liveMux);
+      ++liveCaptured;
+      if (old) {
+        esp_camera_fb_return(old);
+        ++liveDropped;
+      }
+      // Zusätzliche Notifications während send() kosten dort nur einen Schleifendurchlauf
+      xTaskNotifyGive(liveWaiter);
+    }
+    vTaskDelayUntil(&next, period);
+  }
+  liveTaskDone = true;
+  vTaskDelete(nullptr);
+}
+
+static camera_fb_t* liveTake() {
+  portENTER_CRITICAL(&liveMux);
+  camera_fb_t* fb = livePending;
+  livePending = nullptr;
+  portEXIT_CRITICAL(&liveMux);
+  return fb;
+}
+
+// Sendet ein Live-Bild; Chunk 0 trägt Bildnummer und Alter seit der Aufnahme,
+// aus denen der Empfänger die Latenz bis zur Anzeige berechnet
+static EspNowSender::Result sendLiveFrame(const uint8_t* buf, size_t len, uint32_t imageId,
+                                          uint16_t seq, uint32_t ageMs, uint16_t v_mV) {
+  uint8_t version = min<uint8_t>(ESP_NOW_PROTOCOL_VERSION, espNowPeerVersion);
+  uint16_t maxPayload = min<uint16_t>(ESP_NOW_MAX_PAYLOAD_LARGE, espNowPeerMaxPayload);
+  uint8_t ext[ESP_NOW_LIVE_EXT_SIZE];
+  uint8_t extLen = espNowLivePack(seq, ageMs > 0xFFFF ? 0xFFFF : ageMs, ext);
+  uint8_t fecM = 0;
+#if ESP_NOW_FEC
+  if (version >= ESP_NOW_PROTOCOL_V2 && (espNowPeerFeatures & ESP_NOW_CAPS_FEATURE_FEC)) fecM = fecParity();
+#endif
+
+  EspNowTxImage img;
+  if (!espNowTxImageInit(img, buf, len, imageId, v_mV, version, maxPayload,
+                         ESP_NOW_CHUNK_CRC, ESP_NOW_FLAG_LIVE, ext, extLen, ESP_NOW_FEC_K, fecM)) {
+    return EspNowSender::SEND_ERROR;
+  }
+  EspNowSender::Stats stats;
+  return espNowSender.send(espNowReceiverMac, img, stats);
+}
+
+// Läuft bis LIVE_MAX_SECONDS abgelaufen sind oder die Brücke an LIVE_STREAM_PIN entfernt
+// wird; danach schaltet setup() den Funk ab und geht wie gewohnt in den Deep Sleep.
+static void runLiveStream(uint16_t v_mV) {
+  ECO_LOGI("[Live] Live-Modus: Ziel %u fps, Qualität %u", LIVE_FPS, LIVE_QUALITY);
+  if (!initCamera(LIVE_FRAMESIZE, LIVE_QUALITY, 2)) {
+    ECO_LOGE("[Live] Kamera-Init fehlgeschlagen");
+    return;
+  }
+  if (!initEspNow()) {
+    ECO_LOGE("[Live] ESP-NOW Init fehlgeschlagen");
+    return;
+  }
+  esp_wifi_set_ps(WIFI_PS_NONE); // Modem-Sleep verzögert MAC-ACKs und Rückmeldungen
+  EspNowSender::Config cfg = espNowSender.config();
+  cfg.nackTimeoutMs = LIVE_NACK_TIMEOUT_MS;
+  cfg.maxNackRounds = 0;
+  cfg.stallTimeoutMs = 500;
+  espNowSender.setConfig(cfg);
+
+  // Das Bild wird kopiert und der Framebuffer sofort zurückgegeben: so nimmt der Sensor
+  // während der Übertragung schon das nächste Bild auf
+  uint8_t* buf = (uint8_t*)malloc(LIVE_MAX_FRAME_BYTES);
+  if (buf == nullptr) {
+    ECO_LOGE("[Live] Kein Speicher für den Sendepuffer");
+    return;
+  }
+
+  liveWaiter = xTaskGetCurrentTaskHandle();
+  liveRunning = true;
+  liveTaskDone = false;
+  xTaskCreatePinnedToCore(liveCaptureTask, "live_cap", 4096, nullptr, 2, nullptr, 1);
+
+  uint32_t idBase = rtcMillis();
+  uint16_t seq = 0;
+  uint32_t sent = 0, incomplete = 0, bytes = 0, sendMs = 0, ageSum = 0;
+  unsigned long t0 = millis();
+  unsigned long lastLog = t0;
+  uint32_t logCaptured = 0, logDropped = 0;
+
+  for (;;) {
+    unsigned long now = millis();
+    if (LIVE_MAX_SECONDS > 0 && now - t0 >= LIVE_MAX_SECONDS * 1000UL) break;
+#if LIVE_STREAM_PIN >= 0
+    if (!LIVE_STREAM && digitalRead(LIVE_STREAM_PIN) == HIGH) {
+      ECO_LOGI("[Live] Brücke an GPIO %d entfernt", LIVE_STREAM_PIN);
+      break;
+    }
+#endif
+    if (now - lastLog >= 1000 && sent > 0) {
+      uint32_t captured = liveCaptured, dropped = liveDropped;
+      ECO_LOGI("[Live] %.1f fps gesendet, %lu aufgenommen, %lu verworfen, %lu unvollständig, "
+               "Mittel %lu Bytes / %lu ms Sendezeit / %lu ms Alter",
+               sent * 1000.0f / (now - lastLog), (unsigned long)(captured - logCaptured),
+               (unsigned long)(dropped - logDropped), (unsigned long)incomplete,
+               (unsigned long)(bytes / sent), (unsigned long)(sendMs / sent), (unsigned long)(ageSum / sent));
+      sent = incomplete = bytes = sendMs = ageSum = 0;
+      logCaptured = captured;
+      logDropped = dropped;
+      lastLog = now;
+    }
+
+    camera_fb_t* fb = liveTake();
+    if (fb == nullptr) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+      continue;
+    }
+    // Zeitstempel des Treibers (esp_timer) beim Abschluss der Aufnahme
+    int64_t capturedUs = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+    size_t len = fb->len;
+    bool fits = len <= LIVE_MAX_FRAME_BYTES;
+    if (fits) memcpy(buf, fb->buf, len);
+    esp_camera_fb_return(fb);
+    if (!fits) {
+      ECO_LOGW("[Live] Bild zu groß (%u Bytes), verworfen", len);
+      continue;
+    }
+
+    uint32_t ageMs = (uint32_t)((esp_timer_get_time() - capturedUs) / 1000);
+    unsigned long tSend = millis();
+    EspNowSender::Result result = sendLiveFrame(buf, len, idBase + seq, seq, ageMs, v_mV);
+    if (result != EspNowSender::ACKED && result != EspNowSender::NO_RESPONSE) ++incomplete;
+    sendMs += millis() - tSend;
+    bytes += len;
+    ageSum += ageMs;
+    ++sent;
+    ++seq;
+  }
+
+  liveRunning = false;
+  unsigned long tStop = millis();
+  while (!liveTaskDone && millis() - tStop < 2000) delay(10);
+  camera_fb_t* fb = liveTake();
+  if (fb) esp_camera_fb_return(fb);
+  free(buf);
+  ECO_LOGI("[Live] Beendet nach %lu s, %u Bilder gesendet, %lu verworfen",
+           (millis() - t0) / 1000, seq, (unsigned long)liveDropped);
+}
+#endif
+
 // Flash-LED Pin
 #define FLASH_LED_PIN 4
 
 static void goDeepSleep() {
-  Serial.println(F("Deep‑Sleep Vorbereitung..."));
-  Serial.flush();
+  ECO_LOGD("Deep‑Sleep Vorbereitung...");
   
   // Kamera sicher deinitialisieren
   if (camera_initialized) {
     esp_err_t err = esp_camera_deinit();
     if (err == ESP_OK) {
       camera_initialized = false;
-      Serial.println(F("[Power] Kamera deinitialisiert"));
-      Serial.flush();
+      ECO_LOGD("[Power] Kamera deinitialisiert");
     } else {
-      Serial.printf("[Power] Kamera Deinit Fehler: %s\n", esp_err_to_name(err));
-      Serial.flush();
+      ECO_LOGE("[Power] Kamera Deinit Fehler: %s", esp_err_to_name(err));
     }
   }
   
@@ -359,35 +1412,178 @@ static void goDeepSleep() {
   // Kamera PWDN Pin auf HIGH setzen (Power Down)
   pinMode(PWDN_GPIO_NUM, OUTPUT);
   digitalWrite(PWDN_GPIO_NUM, HIGH);
-  Serial.println(F("[Power] Kamera PWDN auf HIGH gesetzt"));
+  ECO_LOGD("[Power] Kamera PWDN auf HIGH gesetzt");
   
   // Flash-LED Pin auf LOW setzen (aus)
   pinMode(FLASH_LED_PIN, OUTPUT);
   digitalWrite(FLASH_LED_PIN, LOW);
-  Serial.println(F("[Power] Flash-LED auf LOW gesetzt"));
+  ECO_LOGD("[Power] Flash-LED auf LOW gesetzt");
   
   // Wakeup-Quellen konfigurieren
   esp_sleep_enable_timer_wakeup(SLEEP_USEC);
   esp_sleep_enable_ext0_wakeup(PIR_PIN, 1);
   
-  Serial.println(F("Deep‑Sleep starten..."));
-  Serial.flush();
-  delay(100); // Etwas mehr Zeit für Serial Output
+  ECO_LOGI("Deep‑Sleep starten... (Wachzeit %lu ms)", millis());
   
   // Neue Überprüfung: Warte, falls PIR-Pin HIGH ist
   unsigned long startWait = millis();
   while (digitalRead(PIR_PIN) == HIGH && (millis() - startWait < 10000)) {
-    Serial.println(F("[PIR] Warten auf LOW..."));
+    ECO_LOGD("[PIR] Warten auf LOW...");
     delay(100);  // Warte 100 ms pro Schleifendurchlauf
   }
   
+  profileFinish();
+  ECO_LOG_FLUSH(); // nur bei direkter Ausgabe: UART leeren, bevor der Takt abgeschaltet wird
   esp_deep_sleep_start();
 }
 
+// ───────── Änderungserkennung ─────────
+#ifndef CHANGE_DETECT
+#define CHANGE_DETECT 1       // Timer-Bilder ohne Änderung nicht senden
+#endif
+#ifndef CHANGE_THRESHOLD
+#define CHANGE_THRESHOLD 6    // Mittlere Helligkeitsdifferenz (0-255), ab der gesendet wird
+#endif
+#ifndef CHANGE_HEARTBEAT
+#define CHANGE_HEARTBEAT 1    // 1 = statt des Bildes nur VBat melden, 0 = gar nichts senden
+#endif
+#ifndef CHANGE_MAX_SKIPS
+#define CHANGE_MAX_SKIPS 12   // Spätestens nach so vielen ausgelassenen Bildern wieder senden
+#endif
+
+#define THUMB_W 32
+#define THUMB_H 24
+#define THUMB_WORDS (THUMB_W * THUMB_H / 4)
+
+static_assert(THUMB_WORDS * 2 * 127 <= 0xFFFF, "SAD-Teilsummen müssen in 16 Bit passen");
+
+// Vorschaubild des zuletzt gesendeten Timer-Bildes (7-Bit Helligkeit, 4 Pixel pro Wort)
+struct ChangeRtcState {
+  bool     valid;
+  uint16_t skipsInRow;
+  uint32_t frames;    // geprüfte Timer-Bilder
+  uint32_t skipped;   // davon ausgelassen
+  uint32_t thumb[THUMB_WORDS];
+};
+RTC_DATA_ATTR ChangeRtcState changeState = {};
+
+// Summe der absoluten Differenzen, 4 Pixel pro 32-Bit-Wort. Die Werte sind 7 Bit
+// breit, daher läuft (a | 0x80) - b nie ins Nachbarbyte über.
+static uint32_t thumbSad(const uint32_t* a, const uint32_t* b) {
+  uint32_t acc = 0; // zwei 16-Bit-Teilsummen
+  for (size_t i = 0; i < THUMB_WORDS; ++i) {
+    uint32_t x = (a[i] | 0x80808080u) - b[i];        // je Byte 128 + a - b
+    uint32_t lt = ((x >> 7) & 0x01010101u) ^ 0x01010101u; // 1 wo a < b
+    uint32_t ltMask = lt * 0xFF;
+    uint32_t v = x ^ 0x80808080u;                     // a - b im Zweierkomplement je Byte
+    uint32_t d = (v & ~ltMask) | ((~v & ltMask) + lt); // |a - b| je Byte
+    acc += (d & 0x00FF00FFu) + ((d >> 8) & 0x00FF00FFu);
+  }
+  return (acc & 0xFFFF) + (acc >> 16);
+}
+
+// Graustufen-Vorschaubild aus dem JPEG. Bei 1/8-Skalierung wertet der Decoder nur
+// die DC-Koeffizienten aus (keine IDCT), danach Mittelung auf THUMB_W x THUMB_H.
+static bool makeThumb(const camera_fb_t* fb, uint32_t* thumb) {
+  size_t w = fb->width / 8, h = fb->height / 8;
+  if (w < THUMB_W || h < THUMB_H) return false;
+  uint8_t* rgb = (uint8_t*)malloc(w * h * 2); // RGB565, 100x75 bei SVGA
+  if (rgb == nullptr) return false;
+  bool ok = jpg2rgb565(fb->buf, fb->len, rgb, JPG_SCALE_8X);
+  if (ok) {
+    uint8_t* out = (uint8_t*)thumb;
+    for (size_t ty = 0; ty < THUMB_H; ++ty) {
+      size_t y0 = ty * h / THUMB_H, y1 = (ty + 1) * h / THUMB_H;
+      for (size_t tx = 0; tx < THUMB_W; ++tx) {
+        size_t x0 = tx * w / THUMB_W, x1 = (tx + 1) * w / THUMB_W;
+        uint32_t sum = 0;
+        for (size_t y = y0; y < y1; ++y) {
+          const uint8_t* px = rgb + (y * w + x0) * 2;
+          for (size_t x = x0; x < x1; ++x, px += 2) {
+            uint16_t c = (px[0] << 8) | px[1]; // jpg2rgb565 schreibt Big-Endian
+            uint32_t r = (c >> 11) << 3, g = ((c >> 5) & 0x3F) << 2, b = (c & 0x1F) << 3;
+            sum += (77 * r + 150 * g + 29 * b) >> 8;
+          }
+        }
+        out[ty * THUMB_W + tx] = (sum / ((y1 - y0) * (x1 - x0))) >> 1; // 7 Bit
+      }
+    }
+  }
+  free(rgb);
+  return ok;
+}
+
+// Vergleicht ein Timer-Bild mit dem zuletzt gesendeten; false = Szene unverändert.
+// diff: mittlere Helligkeitsdifferenz (0-255)
+static bool sceneChanged(const camera_fb_t* fb, uint8_t& diff) {
+  static uint32_t thumb[THUMB_WORDS];
+  unsigned long t0 = micros();
+  if (!makeThumb(fb, thumb)) {
+    ECO_LOGW("[Change] Vorschaubild fehlgeschlagen, sende Bild");
+    diff = 255;
+    return true;
+  }
+  uint32_t mean = 255;
+  if (changeState.valid) {
+    mean = thumbSad(thumb, changeState.thumb) * 2 / (THUMB_W * THUMB_H); // 7 -> 8 Bit
+  }
+  unsigned long us = micros() - t0;
+  diff = min<uint32_t>(mean, 255);
+
+  bool changed = !changeState.valid || mean >= CHANGE_THRESHOLD ||
+                 changeState.skipsInRow >= CHANGE_MAX_SKIPS;
+  ++changeState.frames;
+  if (changed) {
+    memcpy(changeState.thumb, thumb, sizeof(thumb)); // neue Referenz
+    changeState.valid = true;
+    changeState.skipsInRow = 0;
+  } else {
+    ++changeState.skipped;
+    ++changeState.skipsInRow;
+  }
+  ECO_LOGI("[Change] Differenz %u (Schwelle %u) in %lu us -> %s, übersprungen %u/%u (%u%%)",
+                diff, CHANGE_THRESHOLD, us, changed ? "senden" : "unverändert",
+                changeState.skipped, changeState.frames, changeState.skipped * 100 / changeState.frames);
+  return changed;
+}
+
+// Lebenszeichen ohne Bild: nur Batteriespannung und Bilddifferenz
+static bool sendHeartbeat(uint16_t vbatMv, uint8_t diff) {
+#if USE_ESP_NOW
+  esp_now_heartbeat_t msg = { ESP_NOW_CTRL_MAGIC, ESP_NOW_CTRL_HEARTBEAT, vbatMv, diff };
+  uint32_t done = espNowSender.txDone();
+  if (esp_now_send(espNowReceiverMac, (uint8_t*)&msg, sizeof(msg)) != ESP_OK) return false;
+  return espNowSender.waitTxDone(done, 100) && espNowSender.txStatus(done);
+#else
+  char url_buffer[400];
+  int n = snprintf(url_buffer, sizeof(url_buffer), "%s?heartbeat=1&vbat=%u&esp_id=%s&wake_reason=%s&scene_diff=%u&wifi_ms=%lu",
+                   serverURL, vbatMv, getEspIdString().c_str(), getWakeupReasonString().c_str(),
+                   diff, (unsigned long)wifiConnectMs);
+  appendProfileQuery(url_buffer + n, sizeof(url_buffer) - n);
+  if (!http.begin(uploadClient, url_buffer)) return false;
+  http.setReuse(true);
+  int rc = http.GET();
+  ECO_LOGI("[Heartbeat] HTTP rc=%d", rc);
+  http.end();
+  if (rc >= 200 && rc < 300) wakeProfileSent = true;
+  return rc >= 200 && rc < 300;
+#endif
+}
+
 // ───────── setup() ─────────
 void setup() {
+#if ECO_LOG_USES_SERIAL
   Serial.begin(115200);
   delay(200); // Reduziert von 300ms
+#elif ECO_LOG_BACKEND == ECO_LOG_RING
+  // Ringpuffer nur nach unerwartetem Neustart (Absturz, Watchdog, Reset-Taste)
+  // ausgeben; ein normales Wecken aus dem Deep Sleep bleibt ohne UART
+  if (esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+    Serial.begin(115200);
+    ecoLogDump([](const char* line) { Serial.println(line); });
+    Serial.flush();
+  }
+#endif
   
   // Brown‑Out‑Detector deaktivieren
   WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0);
@@ -408,87 +1604,144 @@ void setup() {
   pinMode(PIR_PIN, INPUT_PULLDOWN);
 
   // Batteriespannung messen
+  profilePhase(WAKE_VBAT);
   float vbat = readVBat();
   uint16_t v_mV = static_cast<uint16_t>(vbat * 1000 + 0.5f);
-  Serial.printf("VBAT %.2f V\n", vbat);
-  
+  ECO_LOGI("VBAT %.2f V", vbat);
 
-  if (!initCamera()) {
-    Serial.println(F("Cam init fail – Sleep"));
+#if USE_ESP_NOW
+  // Live-Modus (Konfiguration oder Brücke an LIVE_STREAM_PIN): streamen statt Einzelbild
+  if (liveRequested()) {
+    profilePhase(WAKE_UPLOAD);
+    runLiveStream(v_mV);
+    profilePhase(WAKE_SLEEP);
+    esp_now_deinit(); // auch nach einem Abbruch in runLiveStream()
+    WiFi.mode(WIFI_OFF);
+    goDeepSleep();
+  }
+#endif
+
+  // Timer-Wecken mit Änderungserkennung ohne Heartbeat: WiFi erst starten, wenn
+  // feststeht, dass das Bild gesendet wird
+  bool timerWake = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+  bool checkChange = CHANGE_DETECT && timerWake;
+
+#if !USE_ESP_NOW
+  // WiFi erst nach der VBat-Messung starten: GPIO14 liegt an ADC2,
+  // der bei aktivem WiFi nicht auslesbar ist.
+  bool wifiStarted = !(checkChange && !CHANGE_HEARTBEAT);
+  if (wifiStarted) startWifiConnect();
+#endif
+
+  // PIR-Wecken: Serienaufnahme, da das Motiv beim Einzelbild oft schon weg ist
+  bool burst = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT0 && PIR_BURST_FRAMES > 1;
+  profilePhase(WAKE_CAMERA);
+  ratePlan();
+  if (!initCamera((framesize_t)rateState.frameSize, rateState.quality, burst ? 2 : 1)) {
+    ECO_LOGE("Cam init fail – Sleep");
+    profilePhase(WAKE_SLEEP);
     goDeepSleep();
   }
 
   bool uploadSuccess = false;
-  uint32_t imageIdForEspNow = millis();
+  uint32_t imageId = rtcMillis(); // millis() wäre nach jedem Wecken fast gleich
+
+  // Kamera ist bereits im Automatikmodus initialisiert. captureSettled() verwirft
+  // Bilder, bis sich die Belichtung eingestellt hat (beide Upload-Pfade).
+
+  static CapturedFrame frames[PIR_BURST_FRAMES > 1 ? PIR_BURST_FRAMES : 1];
+
+  // Belichtung einschwingen lassen und aufnehmen (HTTP: WiFi verbindet parallel)
+  profilePhase(WAKE_CAPTURE);
+  uint8_t frameCount = captureFrames(frames, burst ? PIR_BURST_FRAMES : 1, imageId, v_mV);
+  if (frameCount > 0) {
+    ECO_LOGI("[Cam] Finale Aufnahme erfolgreich erstellt (%lu ms nach Wecken).", millis());
+  }
 
-  // Kamera ist bereits im Automatikmodus initialisiert.
-  // Die Dummy-Aufnahmen im HTTP-Upload-Pfad helfen dem Sensor, sich einzustellen.
-  // Für ESP-NOW könnten ähnliche Dummy-Aufnahmen sinnvoll sein, falls Belichtungsprobleme auftreten.
-  // Aktuell wird für ESP-NOW direkt das erste Bild nach der Initialisierung genommen.
+  // Unverändertes Timer-Bild: nicht senden, höchstens Heartbeat
+  uint8_t sceneDiff = 0;
+  bool unchanged = checkChange && frameCount == 1 && frames[0].fb != nullptr &&
+                   !sceneChanged(frames[0].fb, sceneDiff);
+  bool needLink = !(unchanged && !CHANGE_HEARTBEAT);
 
+  profilePhase(WAKE_LINK);
 #if USE_ESP_NOW
-  Serial.println(F("[Main] ESP-NOW Upload ausgewählt."));
-  if (!initEspNow()) {
-    Serial.println(F("[Main] ESP-NOW Init fail – Sleep"));
-  } else {
-    if (camera_fb_t* fb = esp_camera_fb_get()) {
-      uploadSuccess = sendJpegEspNow(fb->buf, fb->len, imageIdForEspNow, v_mV);
-      esp_camera_fb_return(fb);
-    } else {
-      Serial.println(F("Foto capture fehlgeschlagen"));
-    }
-    esp_now_deinit();
-    Serial.println(F("[ESP-NOW] Deinitialisiert."));
+  ECO_LOGI("[Main] ESP-NOW Upload ausgewählt.");
+  // Ab hier nur noch Funk: zwischen den Callbacks blockiert der Task und die CPU
+  // wartet im Idle-Task, ein niedrigerer Takt senkt dabei den Grundstrom
+  if (ESP_NOW_CPU_MHZ > 0 && needLink) setCpuFrequencyMhz(ESP_NOW_CPU_MHZ);
+  // Funk erst nach der Aufnahme starten
+  bool linkReady = needLink && initEspNow();
+  if (needLink && !linkReady) {
+    ECO_LOGE("[Main] ESP-NOW Init fail");
   }
 #else
-  Serial.println(F("[Main] HTTP Upload ausgewählt."));
-  camera_fb_t* fb = esp_camera_fb_get(); // Erste Aufnahme vor WiFi-Verbindung
+  ECO_LOGI("[Main] HTTP Upload ausgewählt.");
+  if (!wifiStarted && needLink) {
+    startWifiConnect();
+    wifiStarted = true;
+  }
+  bool linkReady = wifiStarted && waitWifiConnect();
+  if (wifiStarted && !linkReady) {
+    ECO_LOGE("WiFi fail");
+  }
+#endif
 
-  if (!fb) {
-    Serial.println(F("Initial camera capture fehlgeschlagen"));
-    // uploadSuccess bleibt false
-  } else {
-    // Dummy-Aufnahmen zur Sensoranpassung
-    Serial.println(F("[Cam] Mache Dummy-Aufnahmen zur Belichtungsanpassung..."));
-    for (int i = 0; i < 6; i++) {
-      esp_camera_fb_return(fb); // Vorherigen Framebuffer freigeben
-      fb = esp_camera_fb_get();
-      if (!fb) {
-        Serial.printf("[Cam] Dummy capture %d fehlgeschlagen\n", i + 1);
-        break; 
-      }
-      delay(40); // Kurze Pause zwischen Dummy-Aufnahmen
+  profilePhase(WAKE_UPLOAD);
+  if (unchanged) {
+    // Bild verwerfen; nur die Batteriespannung melden (falls aktiviert)
+    releaseFrame(frames[0]);
+    frameCount = 0;
+    uploadSuccess = !CHANGE_HEARTBEAT || (linkReady && sendHeartbeat(v_mV, sceneDiff));
+    if (uploadSuccess) {
+      ECO_LOGI("[Change] Szene unverändert, Upload übersprungen");
+    } else {
+      ECO_LOGE("[Change] Heartbeat fehlgeschlagen");
     }
+  } else if (frameCount == 0) {
+    ECO_LOGE("[Cam] Aufnahme fehlgeschlagen");
+    // uploadSuccess bleibt false
+  }
 
-    if (!fb) {
-      Serial.println(F("[Cam] Finale Aufnahme nach Dummies fehlgeschlagen"));
-      // uploadSuccess bleibt false, fb ist bereits NULL oder wurde freigegeben
+  // Alle Bilder dieser Aufnahme in einer Sitzung senden; nach dem ersten Fehler
+  // werden die restlichen direkt zwischengespeichert.
+  uint8_t sentFrames = 0;
+  for (uint8_t i = 0; i < frameCount; ++i) {
+    CapturedFrame& frame = frames[i];
+    if (linkReady && sentFrames == i && uploadFrame(frame.data(), frame.info.len, frame.info, false)) {
+      ++sentFrames;
     } else {
-      Serial.println(F("[Cam] Finale Aufnahme erfolgreich erstellt."));
-      if (!wifiConnect()) {
-        Serial.println(F("WiFi fail – Sleep"));
-        esp_camera_fb_return(fb); // Framebuffer freigeben, da nicht gesendet
-        // uploadSuccess bleibt false
-      } else {
-        String esp_id = getEspIdString();
-        String wake_reason = getWakeupReasonString();
-        char url_buffer[350]; // Puffer vergrößert für zusätzliche Parameter
-        snprintf(url_buffer, sizeof(url_buffer), "%s?vbat=%u&esp_id=%s&wake_reason=%s", 
-                 serverURL, v_mV, esp_id.c_str(), wake_reason.c_str());
-        uploadSuccess = sendJpeg(fb->buf, fb->len, url_buffer);
-        esp_camera_fb_return(fb); // Framebuffer nach dem Senden freigeben
-        
-        WiFi.disconnect(true);
-        Serial.println(F("WiFi getrennt."));
-      }
+      deferFrame(frame.data(), frame.info.len, frame.info); // beim nächsten Wecken erneut versuchen
     }
+    releaseFrame(frame);
+  }
+  if (frameCount > 0) {
+    uploadSuccess = sentFrames == frameCount;
+  }
+
+  // Verbindung steht: zwischengespeicherte Bilder in derselben Sitzung nachsenden
+  if (linkReady && (uploadSuccess || frameCount == 0)) {
+    drainFrameQueue();
+  }
+
+  profilePhase(WAKE_SLEEP);
+#if USE_ESP_NOW
+  if (linkReady) {
+    esp_now_deinit();
+    ECO_LOGI("[ESP-NOW] Deinitialisiert.");
+  }
+#else
+  if (linkReady) {
+    uploadClient.stop();
+    WiFi.disconnect(true);
+    ECO_LOGI("WiFi getrennt.");
   }
 #endif
 
   if (uploadSuccess) {
-    Serial.println(F("Bild-Upload erfolgreich abgeschlossen."));
+    ECO_LOGI("Bild-Upload erfolgreich abgeschlossen.");
   } else {
-    Serial.println(F("Bild-Upload fehlgeschlagen."));
+    ECO_LOGE("Bild-Upload fehlgeschlagen.");
   }
   
   // WiFi komplett ausschalten
@@ -0,0 +1,409 @@
+// ────────────────────────────────────────────────────────────────
+//  EcoSnapCam – Unit-Tests für das ESP-NOW Protokoll (lib/EcoSnapProtocol)
+//  Zerlegt die echten ESP32-CAM Aufnahmen aus data/bench mit
+//  espNowBuildChunk, parst die Pakete wie der Empfänger und setzt sie
+//  mit ImageAssembly wieder zusammen.
+//  pio test -e native
+// ────────────────────────────────────────────────────────────────
+#include <unity.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "EspNowProtocol.h"
+#include "ImageAssembly.h"
+
+#define TEST_RX_BUFFER_SIZE 262144
+#define TEST_FEC_K 8
+#define TEST_FEC_PARITY_SLOTS 4
+
+struct Fixture {
+  std::string name;
+  std::vector<uint8_t> data;
+};
+
+static std::vector<Fixture> fixtures;
+static ImageAssembly assembly;
+static std::vector<uint8_t> rxBuffer(TEST_RX_BUFFER_SIZE);
+static std::vector<uint8_t> parityStore(TEST_FEC_PARITY_SLOTS * ESP_NOW_MAX_PAYLOAD_LARGE);
+static uint8_t packet[ESP_NOW_MAX_PAYLOAD_LARGE];
+static uint32_t nextImageId = 1;
+
+// ───────── Fixtures ─────────
+static bool readFile(const std::string& path, std::vector<uint8_t>& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == nullptr) return false;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  out.resize(size > 0 ? size : 0);
+  bool ok = size > 0 && fread(out.data(), 1, size, f) == (size_t)size;
+  fclose(f);
+  return ok;
+}
+
+static void loadFixtures(const std::string& dir) {
+  DIR* d = opendir(dir.c_str());
+  if (d == nullptr) return;
+  while (dirent* entry = readdir(d)) {
+    std::string name = entry->d_name;
+    if (name.size() < 5 || name.compare(name.size() - 4, 4, ".jpg") != 0) continue;
+    Fixture fx;
+    fx.name = name;
+    if (readFile(dir + "/" + name, fx.data)) fixtures.push_back(std::move(fx));
+  }
+  closedir(d);
+  std::sort(fixtures.begin(), fixtures.end(), [](const Fixture& a, const Fixture& b) { return a.name < b.name; });
+}
+
+// pio test startet im Projektverzeichnis; sonst relativ zu dieser Datei suchen
+static void loadFixtures() {
+  loadFixtures("data/bench");
+  if (!fixtures.empty()) return;
+  std::string src = __FILE__;
+  size_t pos = src.rfind("test/test_protocol/");
+  if (pos != std::string::npos) loadFixtures(src.substr(0, pos) + "data/bench");
+}
+
+// ───────── Hilfsfunktionen ─────────
+static EspNowTxImage makeImage(const Fixture& fx, uint8_t version, uint16_t maxPayload, bool crc,
+                               uint8_t fecM = 0) {
+  EspNowTxImage img;
+  bool ok = espNowTxImageInit(img, fx.data.data(), fx.data.size(), nextImageId++, 3700, version, maxPayload, crc,
+                              0, nullptr, 0, fecM ? TEST_FEC_K : 0, fecM);
+  TEST_ASSERT_TRUE_MESSAGE(ok, fx.name.c_str());
+  return img;
+}
+
+static bool beginImage(const EspNowTxImage& img) {
+  return assembly.begin(img.image_id, img.len, img.total_chunks, img.chunk_size, rxBuffer.data(), rxBuffer.size());
+}
+
+// Baut Paket seq und parst es wie der Empfänger
+static EspNowChunk buildAndParse(const EspNowTxImage& img, uint16_t seq) {
+  size_t len = espNowBuildChunk(img, seq, packet);
+  EspNowChunk chunk;
+  TEST_ASSERT_TRUE(espNowParseChunk(packet, len, chunk));
+  return chunk;
+}
+
+static ImageAssembly::Result sendPacket(const EspNowTxImage& img, uint16_t seq) {
+  return assembly.add(buildAndParse(img, seq));
+}
+
+static void assertIdentical(const Fixture& fx) {
+  TEST_ASSERT_TRUE_MESSAGE(assembly.complete(), fx.name.c_str());
+  TEST_ASSERT_TRUE_MESSAGE(assembly.verify(), fx.name.c_str());
+  TEST_ASSERT_EQUAL_UINT32(fx.data.size(), assembly.receivedBytes());
+  TEST_ASSERT_EQUAL_MEMORY_MESSAGE(fx.data.data(), assembly.buffer(), fx.data.size(), fx.name.c_str());
+}
+
+// Sendet alle Chunks außer den als verloren markierten
+static void sendAllExcept(const EspNowTxImage& img, const std::vector<bool>& lost) {
+  for (uint16_t i = 0; i < img.total_chunks; ++i) {
+    if (!lost[i]) TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_NEW, sendPacket(img, i));
+  }
+}
+
+// ───────── Tests ─────────
+void setUp() {
+  assembly.setParityStore(nullptr, 0);
+  assembly.reset();
+}
+
+void tearDown() {}
+
+void test_fixtures_present() {
+  TEST_ASSERT_TRUE_MESSAGE(fixtures.size() >= 3, "data/bench enthaelt zu wenige JPEGs");
+  for (const Fixture& fx : fixtures) {
+    TEST_ASSERT_TRUE_MESSAGE(fx.data.size() > 4 && fx.data[0] == 0xFF && fx.data[1] == 0xD8, fx.name.c_str());
+  }
+}
+
+void test_reassembly_byte_identical() {
+  struct Variant { uint8_t version; uint16_t maxPayload; bool crc; };
+  const Variant variants[] = {
+    { ESP_NOW_PROTOCOL_V1, ESP_NOW_MAX_PAYLOAD, false },
+    { ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD, false },
+    { ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD, true },
+    { ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD_LARGE, true },
+  };
+  for (const Fixture& fx : fixtures) {
+    for (const Variant& v : variants) {
+      EspNowTxImage img = makeImage(fx, v.version, v.maxPayload, v.crc);
+      TEST_ASSERT_TRUE(beginImage(img));
+      for (uint16_t i = 0; i < img.total_chunks; ++i) {
+        size_t len = espNowBuildChunk(img, i, packet);
+        TEST_ASSERT_TRUE(len <= v.maxPayload);
+        EspNowChunk chunk;
+        TEST_ASSERT_TRUE(espNowParseChunk(packet, len, chunk));
+        TEST_ASSERT_EQUAL_UINT16(i, chunk.chunk_index);
+        TEST_ASSERT_EQUAL(i == img.total_chunks - 1, espNowIsLastPacket(chunk));
+        TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_NEW, assembly.add(chunk));
+      }
+      TEST_ASSERT_EQUAL(v.crc, assembly.hasImageCrc());
+      assertIdentical(fx);
+    }
+  }
+}
+
+void test_out_of_order_and_duplicates() {
+  for (const Fixture& fx : fixtures) {
+    EspNowTxImage img = makeImage(fx, ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD, true);
+    std::vector<uint16_t> order(img.total_chunks);
+    for (uint16_t i = 0; i < img.total_chunks; ++i) order[i] = i;
+    uint32_t seed = img.image_id;
+    for (uint16_t i = img.total_chunks - 1; i > 0; --i) {
+      seed = seed * 1664525u + 1013904223u;
+      std::swap(order[i], order[(seed >> 8) % (i + 1)]);
+    }
+
+    TEST_ASSERT_TRUE(beginImage(img));
+    for (uint16_t n = 0; n < img.total_chunks; ++n) {
+      TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_NEW, sendPacket(img, order[n]));
+      // Jeder dritte Chunk kommt doppelt an (verlorenes ACK auf MAC-Ebene)
+      if (n % 3 == 0) TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_DUPLICATE, sendPacket(img, order[n]));
+      TEST_ASSERT_EQUAL_UINT16(n + 1, assembly.receivedChunks());
+    }
+    assertIdentical(fx);
+
+    // Wiederholungen nach dem Abschluss ändern nichts
+    TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_DUPLICATE, sendPacket(img, 0));
+    TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_DUPLICATE, sendPacket(img, img.total_chunks - 1));
+    assertIdentical(fx);
+  }
+}
+
+void test_foreign_chunk_invalid() {
+  const Fixture& fx = fixtures.front();
+  EspNowTxImage img = makeImage(fx, ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD, true);
+  EspNowTxImage other = makeImage(fx, ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD, true);
+  TEST_ASSERT_TRUE(beginImage(img));
+  TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_INVALID, sendPacket(other, 0));
+  TEST_ASSERT_EQUAL_UINT16(0, assembly.receivedChunks());
+}
+
+void test_nack_ranges() {
+  for (const Fixture& fx : fixtures) {
+    EspNowTxImage img = makeImage(fx, ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD, true);
+    uint16_t last = img.total_chunks - 1;
+    TEST_ASSERT_TRUE(img.total_chunks > 10);
+    std::vector<bool> lost(img.total_chunks, false);
+    lost[0] = lost[5] = lost[6] = lost[7] = lost[last] = true;
+
+    TEST_ASSERT_TRUE(beginImage(img));
+    sendAllExcept(img, lost);
+    TEST_ASSERT_FALSE(assembly.complete());
+
+    esp_now_nack_t msg;
+    size_t len = assembly.buildNack(msg);
+    const esp_now_nack_t* parsed = espNowParseNack((const uint8_t*)&msg, len);
+    TEST_ASSERT_NOT_NULL(parsed);
+    TEST_ASSERT_EQUAL_UINT32(img.image_id, parsed->image_id);
+    TEST_ASSERT_EQUAL_UINT16(img.total_chunks - 5, parsed->received_chunks);
+    TEST_ASSERT_EQUAL_UINT8(3, parsed->range_count);
+    TEST_ASSERT_EQUAL_UINT16(0, parsed->ranges[0].start);
+    TEST_ASSERT_EQUAL_UINT16(1, parsed->ranges[0].count);
+    TEST_ASSERT_EQUAL_UINT16(5, parsed->ranges[1].start);
+    TEST_ASSERT_EQUAL_UINT16(3, parsed->ranges[1].count);
+    TEST_ASSERT_EQUAL_UINT16(last, parsed->ranges[2].start);
+    TEST_ASSERT_EQUAL_UINT16(1, parsed->ranges[2].count);
+
+    // Nachgeforderte Bereiche senden: Bild vollständig, NACK ohne Bereiche = ACK
+    for (uint8_t r = 0; r < parsed->range_count; ++r) {
+      for (uint16_t i = 0; i < msg.ranges[r].count; ++i) {
+        TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_NEW, sendPacket(img, msg.ranges[r].start + i));
+      }
+    }
+    assertIdentical(fx);
+    len = assembly.buildNack(msg);
+    TEST_ASSERT_EQUAL_UINT8(0, msg.range_count);
+    TEST_ASSERT_EQUAL_UINT16(img.total_chunks, msg.received_chunks);
+    TEST_ASSERT_EQUAL(ESP_NOW_NACK_HEADER_SIZE, len);
+  }
+}
+
+void test_nack_range_limit() {
+  // Jeder zweite Chunk fehlt: mehr Lücken als in ein NACK passen, die ersten werden gemeldet
+  const Fixture& fx = *std::max_element(fixtures.begin(), fixtures.end(),
+                                        [](const Fixture& a, const Fixture& b) { return a.data.size() < b.data.size(); });
+  EspNowTxImage img = makeImage(fx, ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD, true);
+  TEST_ASSERT_TRUE(img.total_chunks / 2 > ESP_NOW_NACK_MAX_RANGES);
+  std::vector<bool> lost(img.total_chunks, false);
+  for (uint16_t i = 0; i < img.total_chunks; i += 2) lost[i] = true;
+
+  TEST_ASSERT_TRUE(beginImage(img));
+  sendAllExcept(img, lost);
+  esp_now_nack_t msg;
+  size_t len = assembly.buildNack(msg);
+  TEST_ASSERT_TRUE(len <= ESP_NOW_MAX_PAYLOAD);
+  TEST_ASSERT_EQUAL_UINT8(ESP_NOW_NACK_MAX_RANGES, msg.range_count);
+  for (uint8_t r = 0; r < msg.range_count; ++r) {
+    TEST_ASSERT_EQUAL_UINT16(r * 2, msg.ranges[r].start);
+    TEST_ASSERT_EQUAL_UINT16(1, msg.ranges[r].count);
+  }
+}
+
+void test_chunk_corrupt_on_bad_crc() {
+  for (const Fixture& fx : fixtures) {
+    EspNowTxImage img = makeImage(fx, ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD, true);
+    const uint16_t bad = 3;
+    TEST_ASSERT_TRUE(beginImage(img));
+    for (uint16_t i = 0; i < img.total_chunks; ++i) {
+      size_t len = espNowBuildChunk(img, i, packet);
+      if (i == bad) packet[len / 2] ^= 0x10; // ein gekipptes Bit in den Nutzdaten
+      EspNowChunk chunk;
+      TEST_ASSERT_TRUE(espNowParseChunk(packet, len, chunk));
+      TEST_ASSERT_EQUAL(i != bad, chunk.crc_ok);
+      TEST_ASSERT_EQUAL(i == bad ? ImageAssembly::CHUNK_CORRUPT : ImageAssembly::CHUNK_NEW, assembly.add(chunk));
+    }
+    TEST_ASSERT_FALSE(assembly.hasChunk(bad));
+    TEST_ASSERT_FALSE(assembly.complete());
+
+    esp_now_nack_t msg;
+    assembly.buildNack(msg);
+    TEST_ASSERT_EQUAL_UINT8(1, msg.range_count);
+    TEST_ASSERT_EQUAL_UINT16(bad, msg.ranges[0].start);
+    TEST_ASSERT_EQUAL_UINT16(1, msg.ranges[0].count);
+
+    TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_NEW, sendPacket(img, bad));
+    assertIdentical(fx);
+  }
+}
+
+void test_image_crc_detects_corruption() {
+  // Ein Fehler, den die Chunk-CRC nicht sieht (crc_ok erzwungen), fällt über die Bild-CRC aus Chunk 0 auf
+  const Fixture& fx = fixtures.front();
+  EspNowTxImage img = makeImage(fx, ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD, true);
+  TEST_ASSERT_TRUE(beginImage(img));
+  for (uint16_t i = 0; i < img.total_chunks; ++i) {
+    EspNowChunk chunk = buildAndParse(img, i);
+    if (i == 2) {
+      chunk.crc_ok = true;
+      const_cast<uint8_t*>(chunk.data)[0] ^= 0x01;
+    }
+    TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_NEW, assembly.add(chunk));
+  }
+  TEST_ASSERT_TRUE(assembly.complete());
+  TEST_ASSERT_FALSE(assembly.verify());
+  assembly.restart();
+  TEST_ASSERT_EQUAL_UINT16(0, assembly.receivedChunks());
+}
+
+void test_fec_recovery() {
+  for (const Fixture& fx : fixtures) {
+    for (uint8_t fecM = 1; fecM <= 2; ++fecM) {
+      EspNowTxImage img = makeImage(fx, ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD, true, fecM);
+      TEST_ASSERT_TRUE(img.total_packets > img.total_chunks);
+      assembly.setParityStore(parityStore.data(), parityStore.size());
+      TEST_ASSERT_TRUE(beginImage(img));
+
+      // Je Gruppe fecM Daten-Chunks verlieren
+      uint16_t dropped = 0;
+      for (uint16_t seq = 0; seq < img.total_packets; ++seq) {
+        EspNowChunk chunk = buildAndParse(img, seq);
+        TEST_ASSERT_EQUAL_UINT8(TEST_FEC_K, chunk.fec_k);
+        TEST_ASSERT_EQUAL_UINT8(fecM, chunk.fec_m);
+        TEST_ASSERT_EQUAL(seq == img.total_packets - 1, espNowIsLastPacket(chunk));
+        if (chunk.fec_parity == ESP_NOW_FEC_DATA) {
+          uint16_t pos = chunk.chunk_index % TEST_FEC_K;
+          if (pos == 0 || (fecM == 2 && pos == 5)) {
+            ++dropped;
+            continue;
+          }
+          TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_NEW, assembly.add(chunk));
+        } else {
+          // Überzählige Paritäten einer bereits vollständigen Gruppe zählen als Duplikat
+          bool groupComplete = true;
+          for (uint16_t i = chunk.chunk_index; i < chunk.chunk_index + TEST_FEC_K && i < img.total_chunks; ++i) {
+            groupComplete = groupComplete && assembly.hasChunk(i);
+          }
+          TEST_ASSERT_EQUAL(groupComplete ? ImageAssembly::CHUNK_DUPLICATE : ImageAssembly::CHUNK_PARITY,
+                            assembly.add(chunk));
+        }
+      }
+      TEST_ASSERT_TRUE(dropped > 0);
+      TEST_ASSERT_EQUAL_UINT16(dropped, assembly.recoveredChunks());
+      assertIdentical(fx);
+    }
+  }
+}
+
+void test_fec_too_many_losses_nacked() {
+  // Mehr Verluste als Paritäten in einer Gruppe: nichts wird erfunden, die Lücken landen im NACK
+  const Fixture& fx = fixtures.front();
+  EspNowTxImage img = makeImage(fx, ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD, true, 1);
+  assembly.setParityStore(parityStore.data(), parityStore.size());
+  TEST_ASSERT_TRUE(beginImage(img));
+  for (uint16_t seq = 0; seq < img.total_packets; ++seq) {
+    EspNowChunk chunk = buildAndParse(img, seq);
+    if (chunk.fec_parity == ESP_NOW_FEC_DATA && (chunk.chunk_index == 9 || chunk.chunk_index == 10)) continue;
+    assembly.add(chunk);
+  }
+  TEST_ASSERT_EQUAL_UINT16(0, assembly.recoveredChunks());
+  esp_now_nack_t msg;
+  assembly.buildNack(msg);
+  TEST_ASSERT_EQUAL_UINT8(1, msg.range_count);
+  TEST_ASSERT_EQUAL_UINT16(9, msg.ranges[0].start);
+  TEST_ASSERT_EQUAL_UINT16(2, msg.ranges[0].count);
+
+  // Mit Chunk 9 reicht die gespeicherte Parität für Chunk 10
+  TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_NEW, sendPacket(img, espNowTxDataSeq(img, 9)));
+  TEST_ASSERT_TRUE(assembly.hasChunk(10));
+  TEST_ASSERT_EQUAL_UINT16(1, assembly.recoveredChunks());
+  assertIdentical(fx);
+}
+
+void test_corrupt_fec_header_ignored() {
+  // Beschädigte erste Pakete mit plausibler, aber falscher FEC-Geometrie dürfen K/M nicht
+  // festlegen, sonst würden alle korrekten Chunks des Bildes als ungültig verworfen
+  const Fixture& fx = fixtures.front();
+  EspNowTxImage img = makeImage(fx, ESP_NOW_PROTOCOL_V2, ESP_NOW_MAX_PAYLOAD, true, 1);
+  assembly.setParityStore(parityStore.data(), parityStore.size());
+  TEST_ASSERT_TRUE(beginImage(img));
+
+  const uint16_t corruptSeqs[] = { 0, TEST_FEC_K }; // Chunk 0 und erste Parität der Gruppe 0
+  for (uint16_t seq : corruptSeqs) {
+    size_t len = espNowBuildChunk(img, seq, packet);
+    EspNowChunk chunk;
+    TEST_ASSERT_TRUE(espNowParseChunk(packet, len, chunk));
+    const uint8_t* fec = espNowFindExt(chunk, ESP_NOW_FLAG_FEC);
+    TEST_ASSERT_NOT_NULL(fec);
+    packet[fec - packet] ^= 0x04; // K 8 -> 12
+    TEST_ASSERT_TRUE(espNowParseChunk(packet, len, chunk));
+    TEST_ASSERT_FALSE(chunk.crc_ok);
+    TEST_ASSERT_EQUAL_UINT8(TEST_FEC_K ^ 0x04, chunk.fec_k);
+    TEST_ASSERT_EQUAL(ImageAssembly::CHUNK_CORRUPT, assembly.add(chunk));
+  }
+  TEST_ASSERT_EQUAL_UINT16(0, assembly.receivedChunks());
+
+  // Danach korrekte Pakete; Chunk 1 fehlt und wird mit der richtigen Geometrie per FEC ersetzt
+  for (uint16_t seq = 0; seq < img.total_packets; ++seq) {
+    EspNowChunk chunk = buildAndParse(img, seq);
+    if (chunk.fec_parity == ESP_NOW_FEC_DATA && chunk.chunk_index == 1) continue;
+    TEST_ASSERT_TRUE(assembly.add(chunk) != ImageAssembly::CHUNK_INVALID);
+  }
+  TEST_ASSERT_EQUAL_UINT16(1, assembly.recoveredChunks());
+  assertIdentical(fx);
+}
+
+int main(int, char**) {
+  loadFixtures();
+  UNITY_BEGIN();
+  RUN_TEST(test_fixtures_present);
+  if (!fixtures.empty()) {
+    RUN_TEST(test_reassembly_byte_identical);
+    RUN_TEST(test_out_of_order_and_duplicates);
+    RUN_TEST(test_foreign_chunk_invalid);
+    RUN_TEST(test_nack_ranges);
+    RUN_TEST(test_nack_range_limit);
+    RUN_TEST(test_chunk_corrupt_on_bad_crc);
+    RUN_TEST(test_image_crc_detects_corruption);
+    RUN_TEST(test_fec_recovery);
+    RUN_TEST(test_fec_too_many_losses_nacked);
+    RUN_TEST(test_corrupt_fec_header_ignored);
+  }
+  return UNITY_END();
+}
@@ -689,6 +689,113 @@ function get_ollama_lock_status() {
     ];
 }
 
+// Fortsetzbarer Upload: Die Kamera sendet das Bild in Segmenten mit
+// "Content-Range: bytes start-end/total" und einer upload_id. Segmente werden in
+// uploads/.partial/ angehängt; jede Antwort meldet den bestätigten Stand im Header
+// X-Upload-Offset. Liefert die vollständigen Bilddaten nach dem letzten Segment,
+// beendet den Request sonst selbst.
+// Die upload_id beruht auf rtcMillis() und kann sich nach einem Stromausfall wiederholen;
+// die mitgesendete CRC32 des Bildes (crc) unterscheidet solche Bilder.
+function handle_resumable_segment($segment, $uploadDir) {
+    $uploadId = preg_replace('/[^a-zA-Z0-9_-]/', '', $_GET['upload_id']);
+    $imageCrc = isset($_GET['crc']) && preg_match('/^[0-9a-fA-F]{8}$/', $_GET['crc']) ? strtolower($_GET['crc']) : '';
+    $partialDir = $uploadDir . '.partial/';
+    if (!is_dir($partialDir)) {
+        mkdir($partialDir, 0755, true);
+    }
+    // Abgebrochene Uploads nach zwei Tagen verwerfen
+    foreach (array_merge(glob($partialDir . '*.part'), glob($partialDir . '*.done')) as $oldPart) {
+        if (filemtime($oldPart) < time() - 2 * 86400) {
+            unlink($oldPart);
+        }
+    }
+    $partPath = $partialDir . $uploadId . ($imageCrc !== '' ? '-' . $imageCrc : '') . '.part';
+    $donePath = $partialDir . $uploadId . '.done'; // abgeschlossen, enthält "Gesamtgröße CRC32"
+    clearstatcache();
+    $received = file_exists($partPath) ? filesize($partPath) : 0;
+    if (file_exists($donePath)) {
+        // Bereits gespeichert (z.B. Antwort ging verloren): nur bei gleicher Größe und CRC als
+        // vollständig melden, sonst ist es ein neues Bild mit wiederholter upload_id
+        list($doneTotal, $doneCrc) = array_pad(explode(' ', trim(file_get_contents($donePath))), 2, '');
+        $rangeTotal = preg_match('/\/(\d+)$/', $_SERVER['HTTP_CONTENT_RANGE'] ?? '', $t) ? (int)$t[1] : (int)$doneTotal;
+        if ($imageCrc !== '' && $doneCrc === $imageCrc && $rangeTotal === (int)$doneTotal) {
+            $received = (int)$doneTotal;
+        } else {
+            unlink($donePath);
+            write_log("Upload {$uploadId}: abgeschlossener Upload gehört zu einem anderen Bild, beginne neu.");
+        }
+    }
+
+    // Statusabfrage (leerer Body): bisher empfangene Bytes melden
+    if (isset($_GET['status'])) {
+        header('X-Upload-Offset: ' . $received);
+        write_log("Upload {$uploadId}: Statusabfrage, {$received} Bytes vorhanden.");
+        echo $received;
+        exit;
+    }
+
+    $range = isset($_SERVER['HTTP_CONTENT_RANGE']) ? $_SERVER['HTTP_CONTENT_RANGE'] : '';
+    if (!preg_match('/^bytes (\d+)-(\d+)\/(\d+)$/', $range, $m)) {
+        http_response_code(400);
+        write_log("Upload {$uploadId}: ungültiger Content-Range '{$range}'.");
+        echo "Fehler: Content-Range fehlt oder ist ungültig.";
+        exit;
+    }
+    $start = (int)$m[1];
+    $end = (int)$m[2];
+    $total = (int)$m[3];
+    if ($end < $start || $end >= $total || $end - $start + 1 != strlen($segment)) {
+        http_response_code(400);
+        write_log("Upload {$uploadId}: Segment passt nicht zu Content-Range '{$range}'.");
+        echo "Fehler: Segmentlänge passt nicht zu Content-Range.";
+        exit;
+    }
+    if ($start != $received) {
+        // Kamera und Server sind nicht synchron: bestätigten Stand melden
+        http_response_code(409);
+        header('X-Upload-Offset: ' . $received);
+        write_log("Upload {$uploadId}: Segment ab {$start}, erwartet ab {$received}.");
+        echo $received;
+        exit;
+    }
+
+    if (file_put_contents($partPath, $segment, FILE_APPEND | LOCK_EX) !== strlen($segment)) {
+        // Teilweise angehängte Daten abschneiden, damit der gemeldete Stand stimmt
+        clearstatcache();
+        if (file_exists($partPath) && filesize($partPath) > $received && ($fh = fopen($partPath, 'r+'))) {
+            ftruncate($fh, $received);
+            fclose($fh);
+        }
+        http_response_code(500);
+        header('X-Upload-Offset: ' . $received);
+        write_log("Upload {$uploadId}: Segment ab {$start} konnte nicht gespeichert werden.");
+        echo "Fehler: Segment konnte nicht gespeichert werden.";
+        exit;
+    }
+    $received = $end + 1;
+    header('X-Upload-Offset: ' . $received);
+    if ($received < $total) {
+        http_response_code(200);
+        echo $received;
+        exit;
+    }
+
+    write_log("Upload {$uploadId}: alle {$total} Bytes empfangen.");
+    $imageData = file_get_contents($partPath);
+    unlink($partPath);
+    $dataCrc = hash('crc32b', $imageData);
+    if ($imageCrc !== '' && $dataCrc !== $imageCrc) {
+        // Segmente passen nicht zusammen: verwerfen, die Kamera beginnt bei 0 neu
+        http_response_code(422);
+        header('X-Upload-Offset: 0');
+        write_log("Upload {$uploadId}: CRC {$dataCrc} statt {$imageCrc}, Upload verworfen.");
+        echo "Fehler: CRC des Bildes stimmt nicht.";
+        exit;
+    }
+    file_put_contents($donePath, $total . ' ' . $dataCrc);
+    return $imageData;
+}
+
 write_log("Request erhalten. Methode: " . $_SERVER['REQUEST_METHOD']);
 
 // Datenbank initialisieren
@@ -712,6 +819,31 @@ if (!is_dir($uploadDir)) {
     die($errorMsg);
 }
 
+// Wachzeit-Profil des vorigen Weckzyklus (Phasen in ms), einmal pro Zyklus mitgesendet.
+// Bei segmentierten Uploads nur mit dem ersten Segment protokollieren.
+$firstSegment = !isset($_GET['status']) && !preg_match('/^bytes [1-9]/', $_SERVER['HTTP_CONTENT_RANGE'] ?? '');
+if ($firstSegment && isset($_GET['prof']) && preg_match('/^\d+(,\d+)*$/', $_GET['prof'])) {
+    $espId = isset($_GET['esp_id']) ? preg_replace('/[^a-zA-Z0-9_-]/', '', $_GET['esp_id']) : 'unknownID';
+    $profileFile = __DIR__ . '/wake_profile.csv';
+    if (!file_exists($profileFile)) {
+        file_put_contents($profileFile, "timestamp,esp_id,wake,wake_reason,boot,vbat,cam,capture,link,upload,sleep\n");
+    }
+    $wakeReason = isset($_GET['wake_reason']) ? preg_replace('/[^a-zA-Z0-9_-]/', '', $_GET['wake_reason']) : '';
+    $line = date('Y-m-d H:i:s') . ',' . $espId . ',' . (int)($_GET['prof_wake'] ?? 0) . ',' . $wakeReason . ',' . $_GET['prof'] . "\n";
+    file_put_contents($profileFile, $line, FILE_APPEND);
+}
+
+// Lebenszeichen der Kamera ohne Bild (Szene seit dem letzten Bild unverändert)
+if (isset($_GET['heartbeat'])) {
+    $espId = isset($_GET['esp_id']) ? preg_replace('/[^a-zA-Z0-9_-]/', '', $_GET['esp_id']) : 'unknownID';
+    $vbat = isset($_GET['vbat']) ? (int)$_GET['vbat'] : 0;
+    $sceneDiff = isset($_GET['scene_diff']) ? (int)$_GET['scene_diff'] : 0;
+    write_log("Heartbeat von " . $espId . ": Szene unverändert (Differenz " . $sceneDiff . "), VBat " . $vbat . " mV");
+    http_response_code(200);
+    echo "OK";
+    exit;
+}
+
 // Behandlung von POST-Requests 
 if ($_SERVER['REQUEST_METHOD'] === 'POST') {
     // Prüfen ob es ein Workflow-Management Request ist (hat 'action' Parameter)
@@ -723,6 +855,9 @@ if ($_SERVER['REQUEST_METHOD'] === 'POST') {
         // Bild-Upload (kein 'action' Parameter, rohe Bilddaten im Body)
         write_log("Bild-Upload POST-Request wird bearbeitet.");
         $imageData = file_get_contents('php://input');
+        if (isset($_GET['upload_id'])) {
+            $imageData = handle_resumable_segment($imageData, $uploadDir);
+        }
 
         if ($imageData === false || empty($imageData)) {
             http_response_code(400);
@@ -733,19 +868,26 @@ if ($_SERVER['REQUEST_METHOD'] === 'POST') {
         }
         write_log("Bilddaten empfangen. Größe: " . strlen($imageData) . " Bytes.");
 
-        // Dateiname generieren (YYYYMMDD-HHMMSS_espid_wakereason_vbatXXXXmV.jpg)
-        $timestampFormatted = date('Ymd-His');
+        // Dateiname generieren (YYYYMMDD-HHMMSS_espid_wakereason_vbatXXXXmV[_bN].jpg)
+        // Nachgesendete Bilder (Zwischenspeicher der Kamera) melden ihr Alter in Sekunden
+        $ageSeconds = isset($_GET['age_s']) ? max(0, (int)$_GET['age_s']) : 0;
+        $captureTime = time() - $ageSeconds;
         $espId = isset($_GET['esp_id']) ? preg_replace('/[^a-zA-Z0-9_-]/', '', $_GET['esp_id']) : 'unknownID';
         $wakeReason = isset($_GET['wake_reason']) ? preg_replace('/[^a-zA-Z0-9_-]/', '', $_GET['wake_reason']) : 'unknownReason';
         $vbat = isset($_GET['vbat']) ? (int)$_GET['vbat'] : null;
 
-        $filename = $timestampFormatted;
-        $filename .= '_' . $espId;
-        $filename .= '_' . $wakeReason;
+        $baseName = date('Ymd-His', $captureTime);
+        $baseName .= '_' . $espId;
+        $baseName .= '_' . $wakeReason;
         if ($vbat !== null) {
-            $filename .= '_vbat' . $vbat . 'mV';
+            $baseName .= '_vbat' . $vbat . 'mV';
+        }
+        // Serienbilder (PIR) kommen innerhalb einer Sekunde: bei belegtem Namen mit
+        // Zähler _b1, _b2, ... speichern; der Zeitstempel bleibt die echte Aufnahmezeit
+        $filename = $baseName . '.jpg';
+        for ($burstSeq = 1; file_exists($uploadDir . $filename); $burstSeq++) {
+            $filename = $baseName . '_b' . $burstSeq . '.jpg';
         }
-        $filename .= '.jpg';
         $filePath = $uploadDir . $filename;
         write_log("Generierter Dateipfad: " . $filePath);
 
@@ -793,7 +935,9 @@ write_log("GET-Request wird bearbeitet (HTML-Seite wird angezeigt).");
 
 // Funktion zum Extrahieren von Metadaten für Filter
 function get_metadata_from_filename($filename) {
-    if (preg_match('/^(\d{8}-\d{6})_([a-zA-Z0-9_-]+)_([a-zA-Z0-9_-]+)(_vbat\d+mV)?\.jpg$/', basename($filename), $matches)) {
+    // Zähler von Serienbildern derselben Sekunde (_b1, _b2, ...) gehört nicht zu den Feldern
+    $basename = preg_replace('/_b\d+\.jpg$/', '.jpg', basename($filename));
+    if (preg_match('/^(\d{8}-\d{6})_([a-zA-Z0-9_-]+)_([a-zA-Z0-9_-]+)(_vbat\d+mV)?\.jpg$/', $basename, $matches)) {
         $timestamp_short = $matches[1];
         $field2_from_regex = $matches[2];
         $field3_from_regex = $matches[3];